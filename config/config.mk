@@ -32,6 +32,18 @@ boot_addr ?= A0000000
 l2_base ?= 80000000
 l2_size ?= 10000
 
+# Pool of every tile (in bytes) for `mempool_tile_alloc()`, in the tile's
+# sequential memory between its copy of the `.l1_seq` section and the stacks
+l1_seq_pool_size ?= 256
+
+# Stack of every core (in bytes). The stacks of a tile's cores sit at the top
+# of the tile's 1 KiB per core of sequential memory. By default, they leave
+# 64 B per tile to the `.l1_seq` section and `l1_seq_pool_size` to the pool,
+# rounded to 16 B stacks, and the link fails if the section and the pool do
+# not fit. A core's stack can use all but its top word and its bottom word,
+# which `mempool_stack_check()` checks for an overflow.
+stack_size ?= $(shell echo $$(( 1024 - (($(l1_seq_pool_size) + 64) / $(num_cores_per_tile) + 15) / 16 * 16 )))
+
 ################################
 ##  Optional functionalities  ##
 ################################
@@ -13,3 +13,6 @@ num_cores ?= 256
 
 # Number of cores per MemPool tile
 num_cores_per_tile ?= 4
+
+# Number of groups, like NumGroups in hardware/src/mempool_pkg.sv
+num_groups ?= 4
@@ -9,7 +9,7 @@
 `include "common_cells/registers.svh"
 `include "common_cells/assertions.svh"
 
-// `SNITCH_ENABLE_PERF Enables mcycle, minstret performance counters (read only)
+// `SNITCH_ENABLE_PERF Enables mcycle, minstret and mhpmcounter3 and up performance counters (read only)
 
 module snitch
   import snitch_pkg::meta_id_t;
@@ -84,6 +84,8 @@ module snitch
   input  logic          data_pvalid_i,
   output logic          data_pready_o,
   input  logic          wake_up_sync_i, // synchronous wake-up interrupt
+  // Performance counters, read as mhpmcounter3 and up
+  input  logic [snitch_pkg::NumPerfCounters-1:0][31:0] perf_counters_i,
   // Core event strobes
   output snitch_pkg::core_events_t core_events_o
 );
@@ -217,9 +219,13 @@ module snitch
   `FFLAR(instret_q, instret_q + 1, !stall, '0, clk_i, rst_i);
   `endif
 
+  logic ld_raw;
+
   always_comb begin
     core_events_o = '0;
     core_events_o.retired_insts = ~stall;
+    // Stalls with a fetched instruction, due to the LSU or a load result
+    core_events_o.stall_load = stall & inst_valid_o & (lsu_stall | (inst_ready_i & ld_raw));
   end
 
   // accelerator offloading interface
@@ -265,6 +271,24 @@ module snitch
   assign dstrs1_ready = ~uses_rs1 | (uses_rs1 & ~sb_q[rs1]);
   assign dst_ready = dstrd_ready & dstrs1_ready;
 
+  // Registers waiting for a load, to attribute the stalls on them to the loads
+  logic [2**RegWidth-1:0] ld_sb_d, ld_sb_q;
+  `FFAR(ld_sb_q, ld_sb_d, '0, clk_i, rst_i)
+
+  always_comb begin
+    ld_sb_d = ld_sb_q;
+    if (retire_load) ld_sb_d[lsu_rd] = 1'b0;
+    if (is_load && !stall && !exception) ld_sb_d[rd] = 1'b1;
+    ld_sb_d[0] = 1'b0;
+  end
+  assign ld_raw = ((opa_select == Reg) & ld_sb_q[rs1])
+                | ((opb_select == Reg | opb_select == SImmediate) & ld_sb_q[rs2])
+                | ((opb_select == RegRd) & ld_sb_q[rd])
+                | ((opc_select == Reg) & ld_sb_q[rd])
+                | ((opc_select == RegRs2) & ld_sb_q[rs2])
+                | (uses_rd & ld_sb_q[rd])
+                | (uses_rs1 & ld_sb_q[rs1]);
+
   assign valid_instr = (inst_ready_i & inst_valid_o) & operands_ready & dst_ready;
   // the accelerator interface stalled us
   assign acc_stall = (acc_qvalid_o & ~acc_qready_i);
@@ -1387,7 +1411,15 @@ module snitch
           csr_rvalue = instret_q[63:32];
         end
         `endif
-        default: csr_rvalue = '0;
+        default: begin
+          csr_rvalue = '0;
+          `ifdef SNITCH_ENABLE_PERF
+          if (inst_data_i[31:20] >= riscv_instr::CSR_MHPMCOUNTER3 &&
+              inst_data_i[31:20] < riscv_instr::CSR_MHPMCOUNTER3 + snitch_pkg::NumPerfCounters) begin
+            csr_rvalue = perf_counters_i[inst_data_i[31:20] - riscv_instr::CSR_MHPMCOUNTER3];
+          end
+          `endif
+        end
       endcase
     end
   end
@@ -194,6 +194,7 @@ module snitch_icache #(
     logic [NR_FETCH_PORTS-1:0] in_cache_ready, in_bypass_ready;
     logic [NR_FETCH_PORTS-1:0] [FETCH_DW-1:0] in_cache_data, in_bypass_data;
     logic [NR_FETCH_PORTS-1:0] in_cache_error, in_bypass_error;
+    snitch_icache_pkg::icache_events_t [NR_FETCH_PORTS-1:0] l0_events;
     for (genvar i = 0; i < NR_FETCH_PORTS; i++) begin : gen_prefetcher
         prefetch_req_t local_prefetch_req;
         logic          local_prefetch_req_valid;
@@ -217,7 +218,7 @@ module snitch_icache #(
             .rst_ni,
             .flush_valid_i,
             .enable_prefetching_i ( enable_prefetching_i [i] ),
-            .icache_events_o      ( icache_events_o [i]      ),
+            .icache_events_o      ( l0_events [i]            ),
             .in_addr_i            ( inst_addr_i    [i]       ),
             .in_data_o            ( in_cache_data  [i]       ),
             .in_error_o           ( in_cache_error [i]       ),
@@ -426,6 +427,19 @@ module snitch_icache #(
         .write_ready_o ( write_ready        )
     );
 
+    // Performance events: the L0 events of every port, and the hits and misses
+    // of its demand (not prefetch) requests in the L1
+    for (genvar i = 0; i < NR_FETCH_PORTS; i++) begin : gen_events
+        logic demand_lookup;
+        assign demand_lookup = lookup_valid & lookup_ready &
+                               ((lookup_id >> 1) == i) & ~lookup_id[0];
+        always_comb begin
+            icache_events_o[i] = l0_events[i];
+            icache_events_o[i].l1_hit = demand_lookup & lookup_hit;
+            icache_events_o[i].l1_miss = demand_lookup & ~lookup_hit;
+        end
+    end
+
     // The miss handler module deals with the result of the lookup. It also
     // keeps track of the pending refills and ensures that no redundant memory
     // requests are made. Upon refill completion, it sends a new tag/data item
@@ -11,6 +11,9 @@ package snitch_icache_pkg;
       logic l0_hit;
       logic l0_prefetch;
       logic l0_double_hit;
+      // Fetches of a port that missed in its L0 and hit or missed in the L1
+      logic l1_hit;
+      logic l1_miss;
     } icache_events_t;
 
     typedef struct packed {
@@ -151,6 +151,11 @@ package snitch_pkg;
     logic issue_fpu_seq;     // includes load/store operations
     logic issue_core_to_fpu; // instructions issued from core to FPU
     logic retired_insts;     // number of instructions retired by the core
+    logic stall_load;        // cycles the core waits for the LSU or a load result
   } core_events_t;
 
+  // Performance counters of the core complex, which the core reads as
+  // mhpmcounter3 and up
+  localparam int unsigned NumPerfCounters = 9;
+
 endpackage
@@ -11,21 +11,9 @@ cd $MEMPOOL_DIR/hardware
 timestamp=`date +%Y%m%d_%H%M%S`
 mkdir load_thru_$timestamp
 
-# Request forced to be in the sequential region
-for seq_prob in `seq 0 0.2 1`; do
-    echo "Prob. of request forced at the sequential region: ${seq_prob}"
-    echo ""
-
-    # Probability request
-    for req_prob in `seq 0.02 0.02 0.6`; do
-        # Clean-up
-        make clean
-
-        # Compile the verilator model
-        tmpfile=`mktemp`
-        tg=1 tg_ncycles=10000 tg_reqprob=${req_prob} tg_seqprob=${seq_prob} make verilate &> /dev/null
-
-        echo "$req_prob `cat build/transcript | grep Average | cut -d: -f2` `cat build/transcript | grep Throughput | cut -d: -f2`" >> load_thru_$timestamp/results_seqprob${seq_prob}
-        echo "Req. Probability: $req_prob | Avg. Latency: `cat build/transcript | grep Average | cut -d: -f2` cycle | Throughput: `cat build/transcript | grep Throughput | cut -d: -f2` req/core/cycle"
-    done
-done
+# Sweep over the probability of a request being forced to be in the sequential
+# region and the request probability. The verilated model is built only once
+# and resets the design between load points.
+tg=1 tg_ncycles=10000 \
+  tg_flags="--tg-sweep-seq-prob=0:1:0.2 --tg-sweep-req-prob=0.02:0.6:0.02 --tg-sweep-out=$MEMPOOL_DIR/hardware/load_thru_$timestamp/results.csv" \
+  make verilate | grep "Req. Probability"
@@ -2,6 +2,8 @@
 // Solderpad Hardware License, Version 0.51, see LICENSE for details.
 // SPDX-License-Identifier: SHL-0.51
 
+`include "common_cells/registers.svh"
+
 module mempool_cc
   import snitch_pkg::meta_id_t;
 #(
@@ -37,6 +39,10 @@ module mempool_cc
   input  logic               data_pvalid_i,
   output logic               data_pready_o,
   input  logic               wake_up_sync_i,
+  // Performance events of the instruction cache and the TCDM interconnect
+  input  snitch_icache_pkg::icache_events_t icache_events_i,
+  input  logic               tcdm_local_req_i,
+  input  logic               tcdm_remote_req_i,
   // Core event strobes
   output snitch_pkg::core_events_t core_events_o
 );
@@ -55,6 +61,9 @@ module mempool_cc
   logic acc_req_d_valid, acc_req_d_ready, acc_resp_d_valid, acc_resp_d_ready;
   logic acc_req_q_valid, acc_req_q_ready, acc_resp_q_valid, acc_resp_q_ready;
 
+  // Performance counters
+  logic [snitch_pkg::NumPerfCounters-1:0][31:0] perf_counters_q;
+
   // Snitch Integer Core
   snitch #(
     .BootAddr ( BootAddr ),
@@ -96,6 +105,7 @@ module mempool_cc
     .data_pvalid_i    ( data_resp_q_valid   ),
     .data_pready_o    ( data_resp_q_ready   ),
     .wake_up_sync_i   ( wake_up_sync_i      ),
+    .perf_counters_i  ( perf_counters_q     ),
     .core_events_o    ( core_events_o       )
   );
 
@@ -195,26 +205,89 @@ module mempool_cc
   assign data_resp_d_valid = data_pvalid_i;
   assign data_pready_o     = data_resp_d_ready;
 
+  // --------------------------
+  // Performance Counters
+  // --------------------------
+  // 32-bit counters of the core's events, read as the CSRs mhpmcounter3 to
+  // mhpmcounter11, see software/runtime/perf_counters.h. The L0 counts its hits
+  // in every cycle that the core fetches, including the fetches of stalled
+  // instructions.
+  logic [snitch_pkg::NumPerfCounters-1:0] perf_events;
+  assign perf_events = {
+    ~inst_valid_o,                                       // mhpmcounter11: cycles in WFI
+    data_qvalid_o & data_qready_i & (data_qamo_o != '0), // mhpmcounter10: AMOs
+    tcdm_remote_req_i,                                   // mhpmcounter9: requests to other tiles
+    tcdm_local_req_i,                                    // mhpmcounter8: requests to the own tile
+    core_events_o.stall_load,                            // mhpmcounter7: load stall cycles
+    icache_events_i.l1_miss,                             // mhpmcounter6: L1 misses
+    icache_events_i.l1_hit,                              // mhpmcounter5: L1 hits
+    icache_events_i.l0_miss,                             // mhpmcounter4: L0 misses
+    icache_events_i.l0_hit                               // mhpmcounter3: L0 hits
+  };
+
+  for (genvar i = 0; i < snitch_pkg::NumPerfCounters; i++) begin: gen_perf_counters
+    `FFAR(perf_counters_q[i], perf_counters_q[i] + perf_events[i], '0, clk_i, rst_i)
+  end
+
   // --------------------------
   // Tracer
   // --------------------------
   // pragma translate_off
+  // Binary trace, see hardware/tb/dpi/snitch_trace.cpp
+  import "DPI-C" function void snitch_trace_open(input int unsigned hart_id);
+  import "DPI-C" function void snitch_trace_record(
+    input int unsigned     hart_id,
+    input longint unsigned sim_time,
+    input longint unsigned cycle,
+    input int unsigned     pc,
+    input int unsigned     insn,
+    input int unsigned     pc_d,
+    input int unsigned     opa,
+    input int unsigned     opb,
+    input int unsigned     writeback,
+    input int unsigned     gpr_rdata_1,
+    input int unsigned     ld_result_32,
+    input int unsigned     alu_result,
+    input int unsigned     acc_pdata_32,
+    input int unsigned     stall_tot,
+    input int unsigned     stall_ins,
+    input int unsigned     stall_raw,
+    input int unsigned     stall_lsu,
+    input int unsigned     stall_acc,
+    input int unsigned     csr_addr,
+    input int unsigned     flags,
+    input int unsigned     rs1,
+    input int unsigned     rs2,
+    input int unsigned     rd,
+    input int unsigned     lsu_rd,
+    input int unsigned     acc_pid,
+    input int unsigned     opa_select,
+    input int unsigned     opb_select,
+    input int unsigned     ls_size);
+  import "DPI-C" function void snitch_trace_close(input int unsigned hart_id);
+
   int f;
   string fn;
   logic [63:0] cycle;
   int unsigned stall, stall_ins, stall_raw, stall_lsu, stall_acc;
 
+  typedef enum logic [1:0] {SrcSnitch =  0, SrcFpu = 1, SrcFpuSeq = 2} trace_src_e;
+  localparam int SnitchTrace = `ifdef SNITCH_TRACE `SNITCH_TRACE `else 0 `endif;
+  localparam int SnitchTraceBinary = `ifdef SNITCH_TRACE_BINARY `SNITCH_TRACE_BINARY `else 0 `endif;
+  localparam int PerfCounters = `ifdef PERF_COUNTERS `PERF_COUNTERS `else 0 `endif;
+
   always_ff @(posedge rst_i) begin
     if(rst_i) begin
-      $sformat(fn, "trace_hart_%04.0f.dasm", hart_id_i);
-      f = $fopen(fn, "w");
-      $display("[Tracer] Logging Hart %d to %s", hart_id_i, fn);
+      if (SnitchTraceBinary) begin
+        snitch_trace_open(hart_id_i);
+      end else begin
+        $sformat(fn, "trace_hart_%04.0f.dasm", hart_id_i);
+        f = $fopen(fn, "w");
+        $display("[Tracer] Logging Hart %d to %s", hart_id_i, fn);
+      end
     end
   end
 
-  typedef enum logic [1:0] {SrcSnitch =  0, SrcFpu = 1, SrcFpuSeq = 2} trace_src_e;
-  localparam int SnitchTrace = `ifdef SNITCH_TRACE `SNITCH_TRACE `else 0 `endif;
-
   always_ff @(posedge clk_i or posedge rst_i) begin
       automatic string trace_entry;
       automatic string extras_str;
@@ -226,55 +299,78 @@ module mempool_cc
         // we are not stalled <==> we have issued and processed an instruction (including offloads)
         // OR we are retiring (issuing a writeback from) a load or accelerator instruction
         if ((i_snitch.csr_trace_q || SnitchTrace) && (!i_snitch.stall || i_snitch.retire_load || i_snitch.retire_acc)) begin
-          // Manual loop unrolling for Verilator
-          // Data type keys for arrays are currently not supported in Verilator
-          extras_str = "{";
-          // State
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "source",      SrcSnitch);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall",       i_snitch.stall);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_tot",   stall);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_ins",   stall_ins);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_raw",   stall_raw);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_lsu",   stall_lsu);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_acc",   stall_acc);
-          // Decoding
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rs1",         i_snitch.rs1);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rs2",         i_snitch.rs2);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rd",          i_snitch.rd);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_load",     i_snitch.is_load);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_store",    i_snitch.is_store);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_branch",   i_snitch.is_branch);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "pc_d",        i_snitch.pc_d);
-          // Operands
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opa",         i_snitch.opa);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opb",         i_snitch.opb);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opa_select",  i_snitch.opa_select);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opb_select",  i_snitch.opb_select);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "write_rd",    i_snitch.write_rd);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "csr_addr",    i_snitch.inst_data_i[31:20]);
-          // Pipeline writeback
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "writeback",   i_snitch.alu_writeback);
-          // Load/Store
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "gpr_rdata_1", i_snitch.gpr_rdata[1]);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ls_size",     i_snitch.ls_size);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ld_result_32",i_snitch.ld_result[31:0]);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "lsu_rd",      i_snitch.lsu_rd);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "retire_load", i_snitch.retire_load);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "alu_result",  i_snitch.alu_result);
-          // Atomics
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ls_amo",      i_snitch.ls_amo);
-          // Accumulator
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "retire_acc",  i_snitch.retire_acc);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "acc_pid",     i_snitch.acc_pid_i);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "acc_pdata_32",i_snitch.acc_pdata_i[31:0]);
-          // FPU offload
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "fpu_offload", 1'b0);
-          extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_seq_insn", 1'b0);
-          extras_str = $sformatf("%s}", extras_str);
+          if (SnitchTraceBinary) begin
+            // Fixed-size records instead of formatted text, see snitch_trace.h
+            snitch_trace_record(hart_id_i, $time, cycle, i_snitch.pc_q, i_snitch.inst_data_i,
+              i_snitch.pc_d, i_snitch.opa, i_snitch.opb, i_snitch.alu_writeback,
+              i_snitch.gpr_rdata[1], i_snitch.ld_result[31:0], i_snitch.alu_result,
+              i_snitch.acc_pdata_i[31:0], stall, stall_ins, stall_raw, stall_lsu, stall_acc,
+              i_snitch.inst_data_i[31:20],
+              // Flags
+              {22'b0,
+               1'b0,                  // is_seq_insn
+               1'b0,                  // fpu_offload
+               i_snitch.retire_acc,
+               i_snitch.ls_amo != 0,
+               i_snitch.retire_load,
+               i_snitch.write_rd,
+               i_snitch.is_branch,
+               i_snitch.is_store,
+               i_snitch.is_load,
+               i_snitch.stall},
+              i_snitch.rs1, i_snitch.rs2, i_snitch.rd, i_snitch.lsu_rd, i_snitch.acc_pid_i,
+              i_snitch.opa_select, i_snitch.opb_select, i_snitch.ls_size);
+          end else begin
+            // Manual loop unrolling for Verilator
+            // Data type keys for arrays are currently not supported in Verilator
+            extras_str = "{";
+            // State
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "source",      SrcSnitch);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall",       i_snitch.stall);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_tot",   stall);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_ins",   stall_ins);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_raw",   stall_raw);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_lsu",   stall_lsu);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "stall_acc",   stall_acc);
+            // Decoding
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rs1",         i_snitch.rs1);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rs2",         i_snitch.rs2);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "rd",          i_snitch.rd);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_load",     i_snitch.is_load);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_store",    i_snitch.is_store);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_branch",   i_snitch.is_branch);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "pc_d",        i_snitch.pc_d);
+            // Operands
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opa",         i_snitch.opa);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opb",         i_snitch.opb);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opa_select",  i_snitch.opa_select);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "opb_select",  i_snitch.opb_select);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "write_rd",    i_snitch.write_rd);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "csr_addr",    i_snitch.inst_data_i[31:20]);
+            // Pipeline writeback
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "writeback",   i_snitch.alu_writeback);
+            // Load/Store
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "gpr_rdata_1", i_snitch.gpr_rdata[1]);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ls_size",     i_snitch.ls_size);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ld_result_32",i_snitch.ld_result[31:0]);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "lsu_rd",      i_snitch.lsu_rd);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "retire_load", i_snitch.retire_load);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "alu_result",  i_snitch.alu_result);
+            // Atomics
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "ls_amo",      i_snitch.ls_amo);
+            // Accumulator
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "retire_acc",  i_snitch.retire_acc);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "acc_pid",     i_snitch.acc_pid_i);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "acc_pdata_32",i_snitch.acc_pdata_i[31:0]);
+            // FPU offload
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "fpu_offload", 1'b0);
+            extras_str = $sformatf("%s'%s': 0x%8x, ", extras_str, "is_seq_insn", 1'b0);
+            extras_str = $sformatf("%s}", extras_str);
 
-          $sformat(trace_entry, "%t %8d 0x%h DASM(%h) #; %s\n",
-              $time, cycle, i_snitch.pc_q, i_snitch.inst_data_i, extras_str);
-          $fwrite(f, trace_entry);
+            $sformat(trace_entry, "%t %8d 0x%h DASM(%h) #; %s\n",
+                $time, cycle, i_snitch.pc_q, i_snitch.inst_data_i, extras_str);
+            $fwrite(f, trace_entry);
+          end
         end
 
         // Reset all stalls when we execute an instruction
@@ -313,8 +409,38 @@ module mempool_cc
     end
 
   final begin
-    $fclose(f);
+    automatic int perf_f;
+    if (SnitchTraceBinary) begin
+      snitch_trace_close(hart_id_i);
+    end else begin
+      $fclose(f);
+    end
+    // Performance counters at the end of the simulation, if tracing is enabled
+    if (SnitchTrace || PerfCounters) begin
+      $sformat(fn, "perf_hart_%04.0f.json", hart_id_i);
+      perf_f = $fopen(fn, "w");
+      $fwrite(perf_f, "{\"core\": %0d, \"cycles\": %0d", hart_id_i, cycle);
+      $fwrite(perf_f, ", \"l0_hit\": %0d, \"l0_miss\": %0d", perf_counters_q[0], perf_counters_q[1]);
+      $fwrite(perf_f, ", \"l1_hit\": %0d, \"l1_miss\": %0d", perf_counters_q[2], perf_counters_q[3]);
+      $fwrite(perf_f, ", \"stall_load\": %0d", perf_counters_q[4]);
+      $fwrite(perf_f, ", \"tcdm_local\": %0d, \"tcdm_remote\": %0d", perf_counters_q[5], perf_counters_q[6]);
+      $fwrite(perf_f, ", \"amo\": %0d, \"wfi\": %0d}\n", perf_counters_q[7], perf_counters_q[8]);
+      $fclose(perf_f);
+    end
+  end
+
+`ifdef CHECKPOINT
+  // Trigger of the Verilator checkpoints, see hardware/tb/verilator/checkpoint
+  import "DPI-C" function void checkpoint_trace_enabled(input int unsigned hart_id);
+
+  logic csr_trace_q;
+  always_ff @(posedge clk_i) begin
+    csr_trace_q <= i_snitch.csr_trace_q;
+    if (!rst_i && i_snitch.csr_trace_q && !csr_trace_q) begin
+      checkpoint_trace_enabled(hart_id_i);
+    end
   end
+`endif
   // pragma translate_on
 
 endmodule
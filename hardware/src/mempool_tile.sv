@@ -99,6 +99,11 @@ module mempool_tile
   logic     [NumCoresPerTile-1:0] snitch_data_pvalid;
   logic     [NumCoresPerTile-1:0] snitch_data_pready;
 
+  // Performance events
+  snitch_icache_pkg::icache_events_t [NumCaches-1:0][NumCoresPerCache-1:0] icache_events;
+  logic [NumCoresPerTile-1:0] tcdm_local_req;
+  logic [NumCoresPerTile-1:0] tcdm_remote_req;
+
   for (genvar c = 0; unsigned'(c) < NumCoresPerTile; c++) begin: gen_cores
     logic [31:0] hart_id;
     assign hart_id = {unsigned'(tile_id_i), c[idx_width(NumCoresPerTile)-1:0]};
@@ -130,6 +135,10 @@ module mempool_tile
         .data_pvalid_i (snitch_data_pvalid[c]                                    ),
         .data_pready_o (snitch_data_pready[c]                                    ),
         .wake_up_sync_i(wake_up_i[c]                                             ),
+        // Performance Events
+        .icache_events_i  (icache_events[c/NumCoresPerCache][c%NumCoresPerCache]),
+        .tcdm_local_req_i (tcdm_local_req[c]                                     ),
+        .tcdm_remote_req_i(tcdm_remote_req[c]                                    ),
         // Core Events
         .core_events_o (/* Unused */                                             )
       );
@@ -185,7 +194,7 @@ module mempool_tile
       .clk_d2_i             (clk_i                   ),
       .rst_ni               (rst_ni                  ),
       .enable_prefetching_i (snitch_inst_valid[c]    ),
-      .icache_events_o      (/* Unused */            ),
+      .icache_events_o      (icache_events[c]        ),
       .flush_valid_i        (1'b0                    ),
       .flush_ready_o        (/* Unused */            ),
       .inst_addr_i          (snitch_inst_addr[c]     ),
@@ -445,6 +454,10 @@ module mempool_tile
   logic             [NumCoresPerTile-1:0] local_resp_interco_ready;
   tcdm_slave_resp_t [NumCoresPerTile-1:0] local_resp_interco_payload;
 
+  // Requests of the cores to their own tile and to other tiles
+  assign tcdm_local_req  = local_req_interco_valid & local_req_interco_ready;
+  assign tcdm_remote_req = remote_req_interco_valid & remote_req_interco_ready;
+
   logic [NumCoresPerTile+NumGroups-1:0][idx_width(NumBanksPerTile)-1:0] local_req_interco_tgt_sel;
   for (genvar j = 0; unsigned'(j) < NumCoresPerTile; j++) begin: gen_local_req_interco_tgt_sel_local
     assign local_req_interco_tgt_sel[j]  = local_req_interco_payload[j].tgt_addr[idx_width(NumBanksPerTile)-1:0];
@@ -25,6 +25,7 @@
 
 #include <svdpi.h>
 
+#include <algorithm>
 #include <cstring>
 #include <string>
 #include <sys/stat.h>
@@ -153,29 +154,43 @@ typedef struct {
   uint64_t st_size;
 } Elf64_Sym;
 
-// address and size
+// A loadable segment. Its data is served straight from the mapped ELF file.
+struct segment_t {
+  uint64_t address;
+  uint64_t mem_size;
+  uint64_t file_size;
+  const uint8_t* data;
+};
+
 std::vector<std::pair<uint64_t, uint64_t>> sections;
 std::map<std::string, uint64_t> symbols;
 // memory based address and content
-std::map<uint64_t, std::vector<uint8_t>> mems;
+std::map<uint64_t, segment_t> segments;
 uint64_t entry;
 int section_index = 0;
-
-static void write (uint64_t address, uint64_t len, uint8_t* buf) {
-  uint64_t datum;
-  std::vector<uint8_t> mem;
-  for (int i = 0; i < len; i++) {
-    mem.push_back(buf[i]);
-  }
-  mems.insert(std::make_pair(address, mem));
-}
+// The mapping of the current ELF file
+char* elf_buf = NULL;
+size_t elf_size = 0;
 
 extern "C" {
   char get_section(long long* address, long long* len);
   char read_section(long long address, const svOpenArrayHandle buffer);
+  char read_section_rows(long long address, const svOpenArrayHandle rows);
   void read_elf(const char* filename);
 }
 
+// Copy |len| bytes of |seg| starting at byte |offset| of the segment to |dst|,
+// filling the bytes beyond the file size with zeros
+static void copy_segment(const segment_t& seg, uint64_t offset, uint8_t* dst,
+                         uint64_t len) {
+  uint64_t n = 0;
+  if (offset < seg.file_size) {
+    n = std::min(len, seg.file_size - offset);
+    memcpy(dst, seg.data + offset, n);
+  }
+  memset(dst + n, 0, len - n);
+}
+
 // Communicate the section address and len
 // Returns:
 // 0 if there are no more sections
@@ -191,21 +206,71 @@ extern "C" char get_section(long long* address, long long* len) {
   }
 }
 
+// Copy the section at |address| into the byte array |buffer|
+// Returns 0 on success
 extern "C" char read_section(long long address, const svOpenArrayHandle buffer) {
   // get actual poitner
-  void* buf = svGetArrayPtr(buffer);
+  uint8_t* buf = (uint8_t*)svGetArrayPtr(buffer);
   // check that the address points to a section
-  assert(mems.count(address) > 0);
+  auto it = segments.find(address);
+  assert(it != segments.end());
+  assert(buf);
   // copy array
-  int i = 0;
-  for (auto &datum : mems.find(address)->second) {
-    *((char *) buf + i) = datum;
-    i++;
+  copy_segment(it->second, 0, buf, std::min<uint64_t>(svSize(buffer, 1),
+                                                      it->second.mem_size));
+  return 0;
+}
+
+// Copy the section at |address| into the array |rows| of memory rows. The
+// first row is the one containing |address|, i.e., |address| does not need to
+// be aligned to the row width. Bytes of the rows that are not covered by the
+// section keep their value, so the caller can pass in the current content of
+// the first and last row when another section shares them. The rows must be
+// packed bit vectors whose width is a multiple of 32 bits.
+// Returns 0 on success
+extern "C" char read_section_rows(long long address,
+                                  const svOpenArrayHandle rows) {
+  auto it = segments.find(address);
+  assert(it != segments.end());
+  const segment_t& seg = it->second;
+
+  uint64_t num_rows = svSize(rows, 1);
+  if (num_rows == 0)
+    return 0;
+  uint64_t row_bytes = svSizeOfArray(rows) / num_rows;
+  uint64_t lead = address % row_bytes;
+  uint8_t* buf = (uint8_t*)svGetArrayPtr(rows);
+
+  if (buf) {
+    // Contiguous rows: one copy for the whole section
+    uint64_t len = std::min(lead + seg.mem_size, num_rows * row_bytes);
+    copy_segment(seg, 0, buf + lead, len - lead);
+    return 0;
+  }
+
+  // Otherwise, copy row by row
+  for (uint64_t r = 0; r < num_rows; r++) {
+    uint8_t* row = (uint8_t*)svGetArrElemPtr1(rows, svLow(rows, 1) + r);
+    int64_t offset = (int64_t)(r * row_bytes) - (int64_t)lead;
+    if (offset + (int64_t)row_bytes <= 0 || offset >= (int64_t)seg.mem_size)
+      continue;
+    uint64_t skip = offset < 0 ? -offset : 0;
+    uint64_t len = std::min<uint64_t>(row_bytes - skip, seg.mem_size - offset - skip);
+    copy_segment(seg, offset + skip, row + skip, len);
   }
   return 0;
 }
 
 extern "C" void read_elf(const char* filename) {
+  // Forget about a previously loaded file
+  if (elf_buf)
+    munmap(elf_buf, elf_size);
+  elf_buf = NULL;
+  sections.clear();
+  segments.clear();
+  symbols.clear();
+  section_index = 0;
+
   int fd = open(filename, O_RDONLY);
   struct stat s;
   assert(fd != -1);
@@ -223,8 +288,6 @@ extern "C" void read_elf(const char* filename) {
 
 
 
-  std::vector<uint8_t> zeros;
-  std::map<std::string, uint64_t> symbols;
 
   #define LOAD_ELF(ehdr_t, phdr_t, shdr_t, sym_t) do { \
   ehdr_t* eh = (ehdr_t*)buf; \
@@ -236,9 +299,10 @@ extern "C" void read_elf(const char* filename) {
     if (ph[i].p_filesz) { \
       assert(size >= ph[i].p_offset + ph[i].p_filesz); \
       sections.push_back(std::make_pair(ph[i].p_paddr, ph[i].p_memsz)); \
-      write(ph[i].p_paddr, ph[i].p_filesz, (uint8_t*)buf + ph[i].p_offset); \
+      segment_t seg = {ph[i].p_paddr, ph[i].p_memsz, ph[i].p_filesz, \
+                       (uint8_t*)buf + ph[i].p_offset}; \
+      segments[ph[i].p_paddr] = seg; \
     } \
-    zeros.resize(ph[i].p_memsz - ph[i].p_filesz); \
     } \
   } \
   shdr_t* sh = (shdr_t*)(buf + eh->e_shoff); \
@@ -274,5 +338,7 @@ extern "C" void read_elf(const char* filename) {
   else
     LOAD_ELF(Elf64_Ehdr, Elf64_Phdr, Elf64_Shdr, Elf64_Sym);
 
-  munmap(buf, size);
+  // Keep the file mapped, the sections are read from it
+  elf_buf = buf;
+  elf_size = size;
 }
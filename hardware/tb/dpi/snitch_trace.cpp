@@ -0,0 +1,153 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Writes the binary Snitch traces of `mempool_cc`. The records of every hart
+// are collected in a buffer and written in large blocks, see snitch_trace.h
+// for the format.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "snitch_trace.h"
+
+// Upper bound on the hart IDs
+#define SNITCH_TRACE_MAX_HARTS 4096
+// Records buffered per hart
+#define SNITCH_TRACE_BUFFER 1024
+
+namespace {
+
+class trace_writer_t {
+public:
+  trace_writer_t(uint32_t hart_id) : file(nullptr), count(0) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "trace_hart_%04u.bin", hart_id);
+    file = fopen(filename, "wb");
+    if (!file) {
+      fprintf(stderr, "[Tracer] Cannot open %s\n", filename);
+      return;
+    }
+    printf("[Tracer] Logging Hart %u to %s\n", hart_id, filename);
+
+    snitch_trace_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNITCH_TRACE_MAGIC, sizeof(header.magic));
+    header.version = SNITCH_TRACE_VERSION;
+    header.record_size = sizeof(snitch_trace_record_t);
+    header.hart_id = hart_id;
+    snitch_trace_le(header);
+    fwrite(&header, sizeof(header), 1, file);
+  }
+
+  ~trace_writer_t() {
+    if (file) {
+      flush();
+      fclose(file);
+    }
+  }
+
+  snitch_trace_record_t &append() {
+    if (count == SNITCH_TRACE_BUFFER) {
+      flush();
+    }
+    return buffer[count++];
+  }
+
+private:
+  FILE *file;
+  size_t count;
+  snitch_trace_record_t buffer[SNITCH_TRACE_BUFFER];
+
+  void flush() {
+    if (file && count) {
+      for (size_t i = 0; i < count; i++) {
+        snitch_trace_le(buffer[i]);
+      }
+      fwrite(buffer, sizeof(snitch_trace_record_t), count, file);
+    }
+    count = 0;
+  }
+};
+
+// Each hart only touches its own writer, such that harts can be traced
+// concurrently
+trace_writer_t *writers[SNITCH_TRACE_MAX_HARTS];
+
+// Flush the traces if the simulation ends without running the final blocks
+struct writers_cleanup_t {
+  ~writers_cleanup_t() {
+    for (trace_writer_t *&writer : writers) {
+      delete writer;
+      writer = nullptr;
+    }
+  }
+} writers_cleanup;
+
+} // namespace
+
+extern "C" {
+void snitch_trace_open(uint32_t hart_id) {
+  if (hart_id >= SNITCH_TRACE_MAX_HARTS) {
+    fprintf(stderr, "[Tracer] Hart %u exceeds the maximum hart ID\n",
+            hart_id);
+    return;
+  }
+  delete writers[hart_id];
+  writers[hart_id] = new trace_writer_t(hart_id);
+}
+
+void snitch_trace_record(
+    uint32_t hart_id, uint64_t time, uint64_t cycle, uint32_t pc,
+    uint32_t insn, uint32_t pc_d, uint32_t opa, uint32_t opb,
+    uint32_t writeback, uint32_t gpr_rdata_1, uint32_t ld_result_32,
+    uint32_t alu_result, uint32_t acc_pdata_32, uint32_t stall_tot,
+    uint32_t stall_ins, uint32_t stall_raw, uint32_t stall_lsu,
+    uint32_t stall_acc, uint32_t csr_addr, uint32_t flags, uint32_t rs1,
+    uint32_t rs2, uint32_t rd, uint32_t lsu_rd, uint32_t acc_pid,
+    uint32_t opa_select, uint32_t opb_select, uint32_t ls_size) {
+  if (hart_id >= SNITCH_TRACE_MAX_HARTS) {
+    return;
+  }
+  // A simulation restored from a checkpoint does not run through the reset
+  if (!writers[hart_id]) {
+    writers[hart_id] = new trace_writer_t(hart_id);
+  }
+  snitch_trace_record_t &rec = writers[hart_id]->append();
+  rec.time = time;
+  rec.cycle = cycle;
+  rec.pc = pc;
+  rec.insn = insn;
+  rec.pc_d = pc_d;
+  rec.opa = opa;
+  rec.opb = opb;
+  rec.writeback = writeback;
+  rec.gpr_rdata_1 = gpr_rdata_1;
+  rec.ld_result_32 = ld_result_32;
+  rec.alu_result = alu_result;
+  rec.acc_pdata_32 = acc_pdata_32;
+  rec.stall_tot = stall_tot;
+  rec.stall_ins = stall_ins;
+  rec.stall_raw = stall_raw;
+  rec.stall_lsu = stall_lsu;
+  rec.stall_acc = stall_acc;
+  rec.csr_addr = csr_addr;
+  rec.flags = flags;
+  rec.rs1 = rs1;
+  rec.rs2 = rs2;
+  rec.rd = rd;
+  rec.lsu_rd = lsu_rd;
+  rec.acc_pid = acc_pid;
+  rec.opa_select = opa_select;
+  rec.opb_select = opb_select;
+  rec.ls_size = ls_size;
+}
+
+void snitch_trace_close(uint32_t hart_id) {
+  if (hart_id < SNITCH_TRACE_MAX_HARTS) {
+    delete writers[hart_id];
+    writers[hart_id] = nullptr;
+  }
+}
+}
@@ -0,0 +1 @@
+../../../toolchain/riscv-isa-sim/spike_dasm/snitch_trace.h
\ No newline at end of file
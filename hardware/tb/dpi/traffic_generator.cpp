@@ -5,35 +5,25 @@
 // Author: Matheus Cavalcante, ETH Zurich
 
 // Includes
+#include <algorithm>
+#include <cassert>
+#include <fstream>
 #include <iostream>
 #include <limits.h>
 #include <map>
-#include <mutex>
-#include <queue>
+#include <memory>
 #include <random>
+#include <sstream>
+#include <stdexcept>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
 
-// Typedefs
-typedef uint32_t addr_t;
-typedef uint32_t req_id_t;
-typedef uint32_t core_id_t;
-
-// Function declarations
-extern "C" {
-void create_request(const core_id_t *core_id, const uint32_t *cycle,
-                    const addr_t *tcdm_base_addr, const addr_t *tcdm_mask,
-                    const addr_t *tile_mask, // Indicates the bits of the addr
-                                             // who identify the tile
-                    const addr_t *seq_mask,  // Indicates the bits that have to
-                                             // be set for a local request
-                    bool *req_valid, req_id_t *req_id, addr_t *req_addr);
-void probe_response(const core_id_t *core_id, const uint32_t *cycle,
-                    const bool req_ready, const bool resp_valid,
-                    const req_id_t *resp_id);
-void print_histogram();
-}
-
-// Request probabilities
+#include "traffic_generator.h"
+
+// Default request probabilities
 #ifndef TG_REQ_PROB
 #define TG_REQ_PROB 0.2
 #endif
@@ -42,24 +32,60 @@ void print_histogram();
 #define TG_SEQ_PROB 0
 #endif
 
-// Number of cycles the simulation has ran
+// Default size of the throughput windows in cycles
+#ifndef TG_WINDOW
+#define TG_WINDOW 1000
+#endif
+
+// Default number of cycles of a run, which the throughput windows cover
 #ifndef TG_NCYCLES
 #define TG_NCYCLES 10000
 #endif
 
+// Largest latency with its own histogram bucket. Longer latencies share an
+// overflow bucket.
+#ifndef TG_MAX_LATENCY
+#define TG_MAX_LATENCY 1024
+#endif
+
 // Number of cores
 #ifndef NUM_CORES
 #define NUM_CORES 256
 #endif
 
-// Randomizer
-std::random_device r;
-std::default_random_engine e1(r());
-std::uniform_int_distribution<addr_t> addr_dist(0, INT_MAX);
-std::uniform_real_distribution<float> real_dist(0, 1);
+// Number of cores per tile
+#ifndef NUM_CORES_PER_TILE
+#define NUM_CORES_PER_TILE 4
+#endif
+
+// Memory architecture, see mempool_pkg
+#define TG_NUM_TILES (NUM_CORES / NUM_CORES_PER_TILE)
+#define TG_NUM_BANKS (4 * NUM_CORES)
+#define TG_SEQ_MEM_SIZE (NUM_CORES_PER_TILE * 1024 * TG_NUM_TILES)
+
+// Number of transaction IDs per core. Matches the outstanding loads of the
+// Snitch LSU when the traffic generator is enabled. Must be a power of two.
+#ifndef TG_NUM_TRAN_IDS
+#define TG_NUM_TRAN_IDS 2048
+#endif
+
+// Runtime configuration, see tg_configure()
+float tg_req_prob = TG_REQ_PROB;
+float tg_seq_prob = TG_SEQ_PROB;
+uint32_t tg_window = TG_WINDOW;
+uint32_t tg_ncycles = TG_NCYCLES;
+std::string tg_pattern_spec = "uniform";
 
-// Mutexes
-std::mutex g_mutex;
+// Tiles per group, see tg_set_num_groups()
+uint32_t tg_num_tiles_per_group = TG_NUM_TILES / 4;
+
+// TCDM address map, as seen by one core
+typedef struct {
+  addr_t base;
+  addr_t mask;
+  addr_t tile_mask;
+  addr_t seq_mask;
+} tcdm_map_t;
 
 // Request struct
 typedef struct {
@@ -67,61 +93,409 @@ typedef struct {
   req_id_t id;
 } request_t;
 
-// Map the starting cycle of each request
-std::map<std::pair<core_id_t, req_id_t>, uint32_t> starting_cycle;
-// Latency histogram
-std::map<uint32_t, uint32_t> latency_histogram;
-// Request queues
-std::map<core_id_t, std::queue<request_t>> requests;
+// Fixed-size FIFO that never allocates
+template <typename T, uint32_t N> class ring_buffer_t {
+  static_assert((N & (N - 1)) == 0, "Size must be a power of two");
+
+public:
+  bool empty() const { return count == 0; }
+  bool full() const { return count == N; }
+  T &front() { return data[head]; }
+  void push(const T &elem) {
+    assert(!full());
+    data[(head + count++) & (N - 1)] = elem;
+  }
+  void pop() {
+    head = (head + 1) & (N - 1);
+    count--;
+  }
+  void clear() { head = count = 0; }
+
+private:
+  T data[N];
+  uint32_t head = 0;
+  uint32_t count = 0;
+};
+
+// Latency histogram with a bucket per latency up to TG_MAX_LATENCY, and an
+// overflow bucket for the longer ones. The sum and the maximum of the
+// latencies are kept separately, such that the average and the maximum stay
+// exact.
+typedef struct {
+  uint64_t count[TG_MAX_LATENCY + 2];
+  uint64_t sum;
+  uint32_t max;
+} latency_histogram_t;
+
+// State of a single core's traffic generator. Each core only ever touches
+// its own state, so the DPI calls of different cores can be evaluated
+// concurrently by a multi-threaded Verilator model without locking.
+typedef struct {
+  // Randomizer
+  std::mt19937 rng;
+  std::uniform_int_distribution<addr_t> addr_dist{0, INT_MAX};
+  std::uniform_real_distribution<float> real_dist{0, 1};
+  // Free transaction IDs
+  ring_buffer_t<req_id_t, TG_NUM_TRAN_IDS> tran_id;
+  // Requests waiting to be accepted by the interconnect
+  ring_buffer_t<request_t, TG_NUM_TRAN_IDS> requests;
+  // Starting cycle of each request, indexed by the transaction ID
+  uint32_t starting_cycle[TG_NUM_TRAN_IDS];
+  // Number of requests generated since the last reset
+  uint64_t step;
+  // Distance of each request, indexed by the transaction ID
+  uint8_t distance[TG_NUM_TRAN_IDS];
+  // Latency histograms per distance
+  latency_histogram_t latency_histogram[TG_NUM_DISTANCES];
+  // Completed transactions per throughput window. The windows are sized by
+  // tg_reset() and cover tg_ncycles cycles.
+  std::vector<uint64_t> window_transactions;
+  // Number of cycles the core was probed since the last reset
+  uint64_t cycles;
+} core_state_t;
+
+// Seed a core's randomizer. Mixing the core ID through a seed sequence keeps
+// the streams of neighboring cores uncorrelated.
+static void seed_core(std::mt19937 &rng, uint32_t seed, core_id_t core_id) {
+  std::seed_seq seq{seed, uint32_t(core_id)};
+  rng.seed(seq);
+}
+
+// Clear a core's requests and statistics
+static void reset_core(core_state_t &core) {
+  core.requests.clear();
+  core.tran_id.clear();
+  for (req_id_t id = 0; id < TG_NUM_TRAN_IDS; id++)
+    core.tran_id.push(id);
+  for (int d = 0; d < TG_NUM_DISTANCES; d++)
+    core.latency_histogram[d] = latency_histogram_t();
+  core.window_transactions.assign((tg_ncycles + tg_window - 1) / tg_window, 0);
+  core.step = 0;
+  core.cycles = 0;
+}
+
+static std::vector<core_state_t> &core_state() {
+  static std::vector<core_state_t> state = [] {
+    std::vector<core_state_t> init(NUM_CORES);
+    std::random_device r;
+    uint32_t seed = r();
+    for (core_id_t c = 0; c < NUM_CORES; c++) {
+      seed_core(init[c].rng, seed, c);
+      reset_core(init[c]);
+    }
+    return init;
+  }();
+  return state;
+}
+
+/**************
+ *  Patterns  *
+ **************/
+
+// Interface of a traffic pattern. Patterns hold no mutable state: the address
+// of a request only depends on the core, the number of requests the core
+// generated so far and the core's random engine. This keeps the patterns
+// safe for concurrent DPI calls.
+class pattern_t {
+public:
+  virtual ~pattern_t() = default;
+  virtual addr_t next_addr(core_state_t &core, core_id_t core_id,
+                           const tcdm_map_t &map) = 0;
+};
+
+// Pattern parameters, parsed from `name,key=value,...`
+typedef std::map<std::string, std::string> pattern_args_t;
+
+static uint32_t get_arg(const pattern_args_t &args, const std::string &key,
+                        uint32_t default_value) {
+  auto it = args.find(key);
+  return it == args.end() ? default_value : std::stoul(it->second, nullptr, 0);
+}
+
+static float get_arg_float(const pattern_args_t &args, const std::string &key,
+                           float default_value) {
+  auto it = args.find(key);
+  return it == args.end() ? default_value : std::stof(it->second);
+}
+
+// Word address within the TCDM, wrapping around its size
+static inline addr_t word_addr(uint64_t word, const tcdm_map_t &map) {
+  return (addr_t(word << 2) & ~map.mask) | (map.base & map.mask);
+}
+
+// Uniformly distributed addresses, optionally forced into the tile's
+// sequential region with probability `tg_seq_prob`
+class uniform_pattern_t : public pattern_t {
+public:
+  addr_t next_addr(core_state_t &core, core_id_t /* core_id */,
+                   const tcdm_map_t &map) override {
+    addr_t addr = core.addr_dist(core.rng);
+    // Make sure the request is in the TCDM region
+    addr = (addr & ~map.mask) | (map.base & map.mask);
+
+    // Should the request be in the sequential region?
+    if (core.real_dist(core.rng) < tg_seq_prob)
+      addr = (addr & ~map.tile_mask) | (map.seq_mask & map.tile_mask);
+
+    return addr;
+  }
+};
+
+// Strided accesses. Core `c` starts at word `c * offset` and advances by
+// `stride` words, which by default is the static `core_id + n * num_cores`
+// work distribution of the kernels.
+class strided_pattern_t : public pattern_t {
+public:
+  strided_pattern_t(const pattern_args_t &args)
+      : stride_(get_arg(args, "stride", NUM_CORES)),
+        offset_(get_arg(args, "offset", 1)) {}
+
+  addr_t next_addr(core_state_t &core, core_id_t core_id,
+                   const tcdm_map_t &map) override {
+    return word_addr(TG_SEQ_MEM_SIZE / 4 + uint64_t(core_id) * offset_ +
+                         core.step * stride_,
+                     map);
+  }
+
+private:
+  uint32_t stride_;
+  uint32_t offset_;
+};
+
+// Loads of a tiled matrix multiplication C = A * B of `dim`x`dim` words,
+// stored row-major in the interleaved region. Each core computes the output
+// blocks of `block`x`block` elements with index `c + n * num_cores`, i.e.,
+// loads `block` elements of a column of A and `block` elements of a row of B
+// per inner-loop iteration.
+class matmul_pattern_t : public pattern_t {
+public:
+  matmul_pattern_t(const pattern_args_t &args)
+      : dim_(get_arg(args, "dim", 64)), block_(get_arg(args, "block", 2)) {
+    if (block_ == 0 || dim_ % block_ != 0)
+      throw std::invalid_argument("dim must be a multiple of block");
+  }
+
+  addr_t next_addr(core_state_t &core, core_id_t core_id,
+                   const tcdm_map_t &map) override {
+    uint64_t blocks_per_row = dim_ / block_;
+    uint64_t loads_per_k = 2 * block_;
+    uint64_t loads_per_block = loads_per_k * dim_;
+
+    uint64_t block =
+        (core_id + core.step / loads_per_block * NUM_CORES) %
+        (blocks_per_row * blocks_per_row);
+    uint64_t k = core.step % loads_per_block / loads_per_k;
+    uint64_t load = core.step % loads_per_k;
+    uint64_t row = block / blocks_per_row * block_;
+    uint64_t col = block % blocks_per_row * block_;
+
+    uint64_t word;
+    if (load < block_) {
+      // A[row + load][k]
+      word = (row + load) * dim_ + k;
+    } else {
+      // B[k][col + load - block]
+      word = uint64_t(dim_) * dim_ + k * dim_ + col + load - block_;
+    }
+    return word_addr(TG_SEQ_MEM_SIZE / 4 + word, map);
+  }
+
+private:
+  uint32_t dim_;
+  uint32_t block_;
+};
+
+// A fraction `prob` of the requests target a single hot bank (`bank`) or a
+// single hot tile (`tile`). The remaining requests are uniformly distributed.
+class hotspot_pattern_t : public uniform_pattern_t {
+public:
+  hotspot_pattern_t(const pattern_args_t &args)
+      : prob_(get_arg_float(args, "prob", 0.5)),
+        hot_tile_(args.count("tile") != 0), hot_(get_arg(args, "bank", 0)) {
+    if (hot_tile_)
+      hot_ = get_arg(args, "tile", 0) % TG_NUM_TILES;
+    else
+      hot_ %= TG_NUM_BANKS;
+  }
+
+  addr_t next_addr(core_state_t &core, core_id_t core_id,
+                   const tcdm_map_t &map) override {
+    addr_t addr = uniform_pattern_t::next_addr(core, core_id, map);
+    if (core.real_dist(core.rng) >= prob_)
+      return addr;
+
+    if (hot_tile_) {
+      // Overwrite the tile bits of the address
+      addr_t tile_lsb = map.tile_mask & -map.tile_mask;
+      return (addr & ~map.tile_mask) | ((hot_ * tile_lsb) & map.tile_mask);
+    }
+
+    // Random row of the hot bank, above the sequential region where the
+    // word index directly selects the bank
+    uint64_t tcdm_words = (~map.mask + uint64_t(1)) / 4;
+    uint64_t seq_rows = TG_SEQ_MEM_SIZE / 4 / TG_NUM_BANKS;
+    uint64_t rows = tcdm_words / TG_NUM_BANKS;
+    uint64_t row = rows > seq_rows ? seq_rows + addr % (rows - seq_rows) : 0;
+    return word_addr(row * TG_NUM_BANKS + hot_, map);
+  }
+
+private:
+  float prob_;
+  bool hot_tile_;
+  uint32_t hot_;
+};
+
+// 5-point 2D stencil over a `width`x`height` image of words, stored row-major
+// in the interleaved region. Core `c` processes the pixels with index
+// `c + n * num_cores` and loads each pixel's center, north, south, west and
+// east neighbours, clamped at the image borders.
+class stencil_pattern_t : public pattern_t {
+public:
+  stencil_pattern_t(const pattern_args_t &args)
+      : width_(get_arg(args, "width", 64)),
+        height_(get_arg(args, "height", 64)) {
+    if (width_ == 0 || height_ == 0)
+      throw std::invalid_argument("empty image");
+  }
+
+  addr_t next_addr(core_state_t &core, core_id_t core_id,
+                   const tcdm_map_t &map) override {
+    uint64_t pixel = (core_id + core.step / 5 * NUM_CORES) %
+                     (uint64_t(width_) * height_);
+    int64_t x = pixel % width_;
+    int64_t y = pixel / width_;
+    switch (core.step % 5) {
+    case 1:
+      y = y > 0 ? y - 1 : y;
+      break;
+    case 2:
+      y = y < height_ - 1 ? y + 1 : y;
+      break;
+    case 3:
+      x = x > 0 ? x - 1 : x;
+      break;
+    case 4:
+      x = x < width_ - 1 ? x + 1 : x;
+      break;
+    }
+    return word_addr(TG_SEQ_MEM_SIZE / 4 + y * width_ + x, map);
+  }
+
+private:
+  uint32_t width_;
+  uint32_t height_;
+};
+
+// Replays the TCDM loads and stores of the `trace_hart_XXXX.dasm` files of an
+// RTL simulation found in `dir`, one trace per core. The streams wrap around
+// at their end. Cores without a trace do not generate any request.
+class trace_pattern_t : public pattern_t {
+public:
+  trace_pattern_t(const pattern_args_t &args) : addrs_(NUM_CORES) {
+    std::string dir = args.count("dir") ? args.at("dir") : ".";
+    uint64_t tcdm_size = uint64_t(TG_NUM_BANKS) * 1024;
+    uint64_t total = 0;
+
+    for (core_id_t c = 0; c < NUM_CORES; c++) {
+      char filename[32];
+      snprintf(filename, sizeof(filename), "trace_hart_%04u.dasm", c);
+      std::ifstream trace(dir + "/" + filename);
+      std::string line;
+      while (std::getline(trace, line)) {
+        // Only consider retired memory instructions
+        if (extra(line, "stall") ||
+            !(extra(line, "is_load") || extra(line, "is_store")))
+          continue;
+        addr_t addr = extra(line, "alu_result");
+        if (addr < tcdm_size)
+          addrs_[c].push_back(addr);
+      }
+      total += addrs_[c].size();
+    }
+
+    if (total == 0)
+      throw std::invalid_argument("no TCDM accesses found in " + dir);
+  }
+
+  bool idle(core_id_t core_id) const { return addrs_[core_id].empty(); }
+
+  addr_t next_addr(core_state_t &core, core_id_t core_id,
+                   const tcdm_map_t & /* map */) override {
+    const std::vector<addr_t> &addrs = addrs_[core_id];
+    return addrs[core.step % addrs.size()];
+  }
+
+private:
+  std::vector<std::vector<addr_t>> addrs_;
+
+  // Value of a `'key': 0x...` entry of the tracer's extras
+  static addr_t extra(const std::string &line, const std::string &key) {
+    size_t pos = line.find("'" + key + "': 0x");
+    if (pos == std::string::npos)
+      return 0;
+    return strtoul(line.c_str() + pos + key.size() + 6, nullptr, 16);
+  }
+};
+
+// Classify a request by the tile it targets, following the address
+// scrambling of the sequential region
+static tg_distance_t request_distance(core_id_t core_id, addr_t addr,
+                                      const tcdm_map_t &map) {
+  addr_t offset = addr & ~map.mask;
+  uint32_t tile;
+  if (offset < TG_SEQ_MEM_SIZE)
+    tile = offset / (TG_SEQ_MEM_SIZE / TG_NUM_TILES);
+  else
+    tile = (addr & map.tile_mask) / (map.tile_mask & -map.tile_mask);
 
-// Transaction IDs
-uint32_t tran_id_initialized = 0;
-std::map<core_id_t, std::queue<req_id_t>> tran_id;
+  uint32_t core_tile = core_id / NUM_CORES_PER_TILE;
+  if (tile == core_tile)
+    return TG_LOCAL_TILE;
+  if (tile / tg_num_tiles_per_group == core_tile / tg_num_tiles_per_group)
+    return TG_SAME_GROUP;
+  return TG_REMOTE_GROUP;
+}
+
+// Active traffic pattern, see tg_set_pattern()
+std::unique_ptr<pattern_t> tg_pattern(new uniform_pattern_t());
+trace_pattern_t *tg_trace_pattern = nullptr;
 
 extern "C" void create_request(const core_id_t *core_id, const uint32_t *cycle,
                                const addr_t *tcdm_base_addr,
                                const addr_t *tcdm_mask, const addr_t *tile_mask,
                                const addr_t *seq_mask, bool *req_valid,
                                req_id_t *req_id, addr_t *req_addr) {
-  // Lock the function
-  std::lock_guard<std::mutex> guard(g_mutex);
+  core_state_t &core = core_state()[*core_id];
 
-  // Initialize the transaction ID queues
-  if (!tran_id_initialized) {
-    for (int c = 0; c < NUM_CORES; c++)
-      for (int id = 0; id < 2048; id++)
-        tran_id[c].push(id);
-    tran_id_initialized = 1;
-  }
+  tcdm_map_t map;
+  map.base = *tcdm_base_addr;
+  map.mask = *tcdm_mask;
+  map.tile_mask = *tile_mask;
+  map.seq_mask = *seq_mask;
 
   // Generate new request
-  if (!tran_id[*core_id].empty()) {
-    if (real_dist(e1) < TG_REQ_PROB) {
+  if (tg_trace_pattern && tg_trace_pattern->idle(*core_id)) {
+    // Nothing to replay
+  } else if (!core.tran_id.empty()) {
+    if (core.real_dist(core.rng) < tg_req_prob) {
       // Generate new address
       request_t next_request;
 
       // Transaction id
-      req_id_t req_id = tran_id[*core_id].front();
-      tran_id[*core_id].pop();
+      req_id_t req_id = core.tran_id.front();
+      core.tran_id.pop();
 
       next_request.id = req_id;
-      next_request.addr = addr_dist(e1);
-      // Make sure the request is in the TCDM region
-      next_request.addr =
-          (next_request.addr & ~(*tcdm_mask)) | (*tcdm_base_addr & *tcdm_mask);
-
-      // Should the request be in the sequential region?
-      if (real_dist(e1) < TG_SEQ_PROB) {
-        next_request.addr =
-            (next_request.addr & ~(*tile_mask)) | (*seq_mask & *tile_mask);
-      }
+      next_request.addr = tg_pattern->next_addr(core, *core_id, map);
+      core.step++;
 
       // Address is aligned to 32 bits
       next_request.addr = (next_request.addr >> 2) << 2;
 
       // Push the request
-      starting_cycle[std::make_pair(*core_id, req_id)] = *cycle;
-      requests[*core_id].push(next_request);
+      core.starting_cycle[req_id] = *cycle;
+      core.distance[req_id] = request_distance(*core_id, next_request.addr, map);
+      core.requests.push(next_request);
     }
   } else {
     std::cerr
@@ -130,10 +504,10 @@ extern "C" void create_request(const core_id_t *core_id, const uint32_t *cycle,
   }
 
   // Is there a request to be sent?
-  if (!requests[*core_id].empty()) {
+  if (!core.requests.empty()) {
     *req_valid = true;
-    *req_id = requests[*core_id].front().id;
-    *req_addr = requests[*core_id].front().addr;
+    *req_id = core.requests.front().id;
+    *req_addr = core.requests.front().addr;
   } else {
     *req_valid = false;
     *req_id = 0;
@@ -144,43 +518,348 @@ extern "C" void create_request(const core_id_t *core_id, const uint32_t *cycle,
 extern "C" void probe_response(const core_id_t *core_id, const uint32_t *cycle,
                                const bool req_ready, const bool resp_valid,
                                const req_id_t *resp_id) {
-  // Lock the function
-  std::lock_guard<std::mutex> guard(g_mutex);
+  core_state_t &core = core_state()[*core_id];
+  core.cycles = uint64_t(*cycle) + 1;
 
   // Acknowledged request
-  if (req_ready && !requests[*core_id].empty()) {
+  if (req_ready && !core.requests.empty()) {
     // Pop the request
-    requests[*core_id].pop();
+    core.requests.pop();
   }
 
   // Acknowledged response
   if (resp_valid) {
+    if (*resp_id >= TG_NUM_TRAN_IDS) {
+      std::cerr << "[traffic_generator] Invalid transaction identifier "
+                << *resp_id << "!" << std::endl;
+      return;
+    }
+
     // Free the request ID
-    tran_id[*core_id].push(*resp_id);
+    core.tran_id.push(*resp_id);
 
     // Account for the latency
-    uint32_t latency =
-        *cycle - starting_cycle[std::make_pair(*core_id, *resp_id)];
-    if (latency_histogram.count(latency) != 0)
-      latency_histogram[latency]++;
-    else
-      latency_histogram[latency] = 1;
+    uint32_t latency = *cycle - core.starting_cycle[*resp_id];
+    latency_histogram_t &histogram =
+        core.latency_histogram[core.distance[*resp_id]];
+    histogram.count[std::min<uint32_t>(latency, TG_MAX_LATENCY + 1)]++;
+    histogram.sum += latency;
+    histogram.max = std::max(histogram.max, latency);
+
+    // Account for the throughput. Responses after tg_ncycles cycles only
+    // count towards the latency.
+    uint32_t window = *cycle / tg_window;
+    if (window < core.window_transactions.size())
+      core.window_transactions[window]++;
+  }
+}
+
+/****************
+ *  Statistics  *
+ ****************/
+
+static void merge(std::vector<uint64_t> &dst, const std::vector<uint64_t> &src) {
+  if (src.size() > dst.size())
+    dst.resize(src.size(), 0);
+  for (size_t i = 0; i < src.size(); i++)
+    dst[i] += src[i];
+}
+
+// Merge the latency histograms of the given cores and distance
+static latency_histogram_t merged_histogram(tg_distance_t distance,
+                                            core_id_t first, core_id_t last) {
+  latency_histogram_t histogram = latency_histogram_t();
+  for (core_id_t c = first; c <= last; c++) {
+    for (int d = 0; d < TG_NUM_DISTANCES; d++) {
+      if (distance != TG_ALL_DISTANCES && distance != d)
+        continue;
+      const latency_histogram_t &src = core_state()[c].latency_histogram[d];
+      for (size_t l = 0; l <= TG_MAX_LATENCY + 1; l++)
+        histogram.count[l] += src.count[l];
+      histogram.sum += src.sum;
+      histogram.max = std::max(histogram.max, src.max);
+    }
+  }
+  return histogram;
+}
+
+// Number of cores generating requests. With the trace pattern, the cores
+// without a trace stay idle and do not count towards the throughput.
+static uint32_t active_cores() {
+  if (!tg_trace_pattern)
+    return NUM_CORES;
+  uint32_t active = 0;
+  for (core_id_t c = 0; c < NUM_CORES; c++)
+    if (!tg_trace_pattern->idle(c))
+      active++;
+  return active;
+}
+
+// Number of cycles simulated since the last reset
+static uint64_t simulated_cycles() {
+  uint64_t cycles = 0;
+  for (const core_state_t &core : core_state())
+    cycles = std::max(cycles, core.cycles);
+  return cycles;
+}
+
+static void histogram_stats(const latency_histogram_t &histogram,
+                            uint64_t cycles, uint32_t num_cores,
+                            tg_stats_t *stats) {
+  *stats = tg_stats_t();
+  stats->cycles = cycles;
+
+  for (size_t l = 0; l <= TG_MAX_LATENCY + 1; l++)
+    stats->transactions += histogram.count[l];
+  if (stats->transactions == 0)
+    return;
+  stats->max_latency = histogram.max;
+
+  // Percentiles: smallest latency covering the given share of transactions.
+  // A percentile in the overflow bucket is bounded by the maximum latency.
+  uint64_t count = 0;
+  uint64_t p50 = (stats->transactions * 50 + 99) / 100;
+  uint64_t p90 = (stats->transactions * 90 + 99) / 100;
+  uint64_t p99 = (stats->transactions * 99 + 99) / 100;
+  for (size_t l = 0; l <= TG_MAX_LATENCY + 1; l++) {
+    uint32_t latency = l <= TG_MAX_LATENCY ? l : histogram.max;
+    if (count < p50 && count + histogram.count[l] >= p50)
+      stats->p50_latency = latency;
+    if (count < p90 && count + histogram.count[l] >= p90)
+      stats->p90_latency = latency;
+    if (count < p99 && count + histogram.count[l] >= p99)
+      stats->p99_latency = latency;
+    count += histogram.count[l];
   }
+
+  stats->avg_latency = (1.0 * histogram.sum) / stats->transactions;
+  if (cycles != 0 && num_cores != 0)
+    stats->throughput = (1.0 * stats->transactions) / (cycles * num_cores);
+}
+
+static const char *distance_name(int distance) {
+  static const char *names[] = {"local_tile", "same_group", "remote_group"};
+  return names[distance];
+}
+
+// Quote a string for a JSON document
+static std::string json_escape(const std::string &str) {
+  std::string escaped;
+  for (char ch : str) {
+    if (ch == '"' || ch == '\\') {
+      escaped += '\\';
+      escaped += ch;
+    } else if ((unsigned char)ch < 0x20) {
+      char buf[8];
+      snprintf(buf, sizeof(buf), "\\u%04x", (unsigned char)ch);
+      escaped += buf;
+    } else {
+      escaped += ch;
+    }
+  }
+  return escaped;
+}
+
+static void write_json_stats(std::ostream &out, const tg_stats_t &stats) {
+  out << "{\"transactions\": " << stats.transactions
+      << ", \"cycles\": " << stats.cycles
+      << ", \"avg_latency\": " << stats.avg_latency
+      << ", \"p50_latency\": " << stats.p50_latency
+      << ", \"p90_latency\": " << stats.p90_latency
+      << ", \"p99_latency\": " << stats.p99_latency
+      << ", \"max_latency\": " << stats.max_latency
+      << ", \"throughput\": " << stats.throughput << "}";
 }
 
 extern "C" void print_histogram() {
-  uint32_t latency = 0;
-  uint32_t tran_counter = 0;
+  tg_stats_t stats;
+  latency_histogram_t latency_histogram =
+      merged_histogram(TG_ALL_DISTANCES, 0, NUM_CORES - 1);
 
   std::cout << "Latency\tCount" << std::endl;
-  for (const auto &it : latency_histogram) {
-    tran_counter += it.second;
-    latency += it.first * it.second;
-    std::cout << it.first << "\t" << it.second << std::endl;
+  for (size_t l = 0; l <= TG_MAX_LATENCY; l++)
+    if (latency_histogram.count[l] != 0)
+      std::cout << l << "\t" << latency_histogram.count[l] << std::endl;
+  if (latency_histogram.count[TG_MAX_LATENCY + 1] != 0)
+    std::cout << ">" << TG_MAX_LATENCY << "\t"
+              << latency_histogram.count[TG_MAX_LATENCY + 1] << std::endl;
+
+  tg_statistics(TG_ALL_DISTANCES, &stats);
+  std::cout << "Simulated cycles: " << stats.cycles << std::endl;
+  std::cout << "Average latency: " << stats.avg_latency << std::endl;
+  std::cout << "Latency percentiles (p50/p90/p99/max): " << stats.p50_latency
+            << "/" << stats.p90_latency << "/" << stats.p99_latency << "/"
+            << stats.max_latency << std::endl;
+  std::cout << "Throughput: " << stats.throughput << std::endl;
+}
+
+extern "C" void tg_set_num_groups(uint32_t num_groups) {
+  tg_num_tiles_per_group = std::max<uint32_t>(TG_NUM_TILES / num_groups, 1);
+}
+
+extern "C" void tg_configure(float req_prob, float seq_prob) {
+  tg_req_prob = req_prob;
+  tg_seq_prob = seq_prob;
+}
+
+extern "C" bool tg_set_pattern(const char *spec) {
+  std::istringstream iss(spec);
+  std::string name;
+  std::string field;
+  pattern_args_t args;
+
+  std::getline(iss, name, ',');
+  while (std::getline(iss, field, ',')) {
+    size_t eq = field.find('=');
+    if (eq == std::string::npos) {
+      std::cerr << "[traffic_generator] Pattern argument `" << field
+                << "' is not of the form key=value." << std::endl;
+      return false;
+    }
+    args[field.substr(0, eq)] = field.substr(eq + 1);
+  }
+
+  try {
+    trace_pattern_t *trace = nullptr;
+    pattern_t *pattern;
+    if (name == "uniform")
+      pattern = new uniform_pattern_t();
+    else if (name == "strided")
+      pattern = new strided_pattern_t(args);
+    else if (name == "matmul")
+      pattern = new matmul_pattern_t(args);
+    else if (name == "hotspot")
+      pattern = new hotspot_pattern_t(args);
+    else if (name == "stencil")
+      pattern = new stencil_pattern_t(args);
+    else if (name == "trace")
+      pattern = trace = new trace_pattern_t(args);
+    else
+      throw std::invalid_argument("unknown pattern `" + name + "'");
+
+    tg_pattern.reset(pattern);
+    tg_trace_pattern = trace;
+    tg_pattern_spec = spec;
+  } catch (const std::exception &err) {
+    std::cerr << "[traffic_generator] Invalid pattern `" << spec
+              << "': " << err.what() << std::endl;
+    return false;
+  }
+  return true;
+}
+
+extern "C" void tg_set_window(uint32_t cycles) {
+  tg_window = cycles ? cycles : 1;
+}
+
+extern "C" void tg_set_ncycles(uint32_t cycles) { tg_ncycles = cycles; }
+
+extern "C" void tg_seed(uint32_t seed) {
+  for (core_id_t c = 0; c < NUM_CORES; c++)
+    seed_core(core_state()[c].rng, seed, c);
+}
+
+extern "C" void tg_reset() {
+  // Drop all in-flight requests and statistics. The DUT is reset alongside,
+  // so no response to a dropped request will ever arrive.
+  for (core_state_t &core : core_state())
+    reset_core(core);
+}
+
+extern "C" void tg_statistics(tg_distance_t distance, tg_stats_t *stats) {
+  histogram_stats(merged_histogram(distance, 0, NUM_CORES - 1),
+                  simulated_cycles(), active_cores(), stats);
+}
+
+extern "C" bool tg_write_stats(const char *filename) {
+  std::ofstream out(filename);
+  if (!out) {
+    std::cerr << "[traffic_generator] Cannot open `" << filename
+              << "' for writing." << std::endl;
+    return false;
+  }
+
+  uint64_t cycles = simulated_cycles();
+  uint32_t num_active = active_cores();
+  tg_stats_t stats;
+
+  out << "{" << std::endl;
+  out << "  \"config\": {\"num_cores\": " << NUM_CORES
+      << ", \"active_cores\": " << num_active
+      << ", \"req_prob\": " << tg_req_prob
+      << ", \"seq_prob\": " << tg_seq_prob << ", \"pattern\": \""
+      << json_escape(tg_pattern_spec) << "\", \"window\": " << tg_window << "},"
+      << std::endl;
+
+  // Summary and per-distance breakdown
+  tg_statistics(TG_ALL_DISTANCES, &stats);
+  out << "  \"summary\": ";
+  write_json_stats(out, stats);
+  out << "," << std::endl << "  \"distance\": {" << std::endl;
+  for (int d = 0; d < TG_NUM_DISTANCES; d++) {
+    tg_statistics(tg_distance_t(d), &stats);
+    out << "    \"" << distance_name(d) << "\": ";
+    write_json_stats(out, stats);
+    out << (d + 1 < TG_NUM_DISTANCES ? "," : "") << std::endl;
+  }
+  out << "  }," << std::endl;
+
+  // Throughput over time, to separate the warm-up from the steady state. Only
+  // the windows of the first tg_ncycles cycles count transactions, so the
+  // cycles simulated afterwards are left out.
+  std::vector<uint64_t> windows;
+  for (const core_state_t &core : core_state())
+    merge(windows, core.window_transactions);
+  uint64_t counted = std::min<uint64_t>(cycles, tg_ncycles);
+  windows.resize((counted + tg_window - 1) / tg_window, 0);
+  out << "  \"windows\": [" << std::endl;
+  for (size_t w = 0; w < windows.size(); w++) {
+    uint64_t start = w * tg_window;
+    uint64_t length = std::min<uint64_t>(tg_window, counted - start);
+    out << "    {\"start\": " << start << ", \"cycles\": " << length
+        << ", \"transactions\": " << windows[w] << ", \"throughput\": ";
+    if (num_active != 0)
+      out << (1.0 * windows[w]) / (length * num_active);
+    else
+      out << 0;
+    out << "}" << (w + 1 < windows.size() ? "," : "") << std::endl;
+  }
+  out << "  ]," << std::endl;
+
+  // Per-core breakdown
+  out << "  \"cores\": [" << std::endl;
+  for (core_id_t c = 0; c < NUM_CORES; c++) {
+    histogram_stats(merged_histogram(TG_ALL_DISTANCES, c, c), cycles, 1,
+                    &stats);
+    out << "    {\"core\": " << c << ", \"stats\": ";
+    write_json_stats(out, stats);
+    for (int d = 0; d < TG_NUM_DISTANCES; d++) {
+      histogram_stats(merged_histogram(tg_distance_t(d), c, c), cycles, 1,
+                      &stats);
+      out << ", \"" << distance_name(d)
+          << "_transactions\": " << stats.transactions;
+    }
+    out << "}" << (c + 1 < NUM_CORES ? "," : "") << std::endl;
+  }
+  out << "  ]," << std::endl;
+
+  // Latency histogram, with the latencies above TG_MAX_LATENCY in one bucket
+  latency_histogram_t histogram =
+      merged_histogram(TG_ALL_DISTANCES, 0, NUM_CORES - 1);
+  out << "  \"histogram\": [";
+  bool first = true;
+  for (size_t l = 0; l <= TG_MAX_LATENCY; l++) {
+    if (histogram.count[l] == 0)
+      continue;
+    out << (first ? "" : ", ") << "[" << l << ", " << histogram.count[l]
+        << "]";
+    first = false;
   }
+  out << "]," << std::endl
+      << "  \"histogram_overflow\": {\"min_latency\": " << TG_MAX_LATENCY + 1
+      << ", \"transactions\": " << histogram.count[TG_MAX_LATENCY + 1] << "}"
+      << std::endl
+      << "}" << std::endl;
 
-  std::cout << "Average latency: " << (1.0 * latency) / tran_counter
-            << std::endl;
-  std::cout << "Throughput: " << (1.0 * tran_counter) / (TG_NCYCLES * NUM_CORES)
-            << std::endl;
+  return true;
 }
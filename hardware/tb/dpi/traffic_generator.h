@@ -0,0 +1,67 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+// Includes
+#include <stdint.h>
+
+// Typedefs
+typedef uint32_t addr_t;
+typedef uint32_t req_id_t;
+typedef uint32_t core_id_t;
+
+// Distance between a core and the tile serving its request
+typedef enum {
+  TG_LOCAL_TILE = 0,
+  TG_SAME_GROUP = 1,
+  TG_REMOTE_GROUP = 2,
+  TG_NUM_DISTANCES = 3,
+  // Selects all distances in tg_statistics()
+  TG_ALL_DISTANCES = TG_NUM_DISTANCES
+} tg_distance_t;
+
+// Statistics of the transactions completed since the last reset
+typedef struct {
+  uint64_t transactions;
+  uint64_t cycles;
+  double avg_latency;
+  uint32_t p50_latency;
+  uint32_t p90_latency;
+  uint32_t p99_latency;
+  uint32_t max_latency;
+  // [req/core/cycle] of the cores generating requests
+  double throughput;
+} tg_stats_t;
+
+// Function declarations
+extern "C" {
+// Called every cycle by the traffic_generator module
+void create_request(const core_id_t *core_id, const uint32_t *cycle,
+                    const addr_t *tcdm_base_addr, const addr_t *tcdm_mask,
+                    const addr_t *tile_mask, // Indicates the bits of the addr
+                                             // who identify the tile
+                    const addr_t *seq_mask,  // Indicates the bits that have to
+                                             // be set for a local request
+                    bool *req_valid, req_id_t *req_id, addr_t *req_addr);
+void probe_response(const core_id_t *core_id, const uint32_t *cycle,
+                    const bool req_ready, const bool resp_valid,
+                    const req_id_t *resp_id);
+// Called at the start of the simulation by every traffic_generator module,
+// with NumGroups of mempool_pkg
+void tg_set_num_groups(uint32_t num_groups);
+
+// Configuration and evaluation. These functions must not be called
+// concurrently with the functions above.
+void print_histogram();
+void tg_configure(float req_prob, float seq_prob);
+bool tg_set_pattern(const char *spec);
+void tg_set_window(uint32_t cycles);
+// Cycles of a run, which the throughput windows of the next tg_reset() cover
+void tg_set_ncycles(uint32_t cycles);
+void tg_seed(uint32_t seed);
+void tg_reset();
+void tg_statistics(tg_distance_t distance, tg_stats_t *stats);
+bool tg_write_stats(const char *filename);
+}
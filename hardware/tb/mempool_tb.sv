@@ -5,6 +5,7 @@
 import "DPI-C" function void read_elf (input string filename);
 import "DPI-C" function byte get_section (output longint address, output longint len);
 import "DPI-C" context function byte read_section(input longint address, inout byte buffer[]);
+import "DPI-C" context function byte read_section_rows(input longint address, inout bit [mempool_pkg::AxiDataWidth-1:0] rows[]);
 
 `define wait_for(signal) \
   do \
@@ -274,8 +275,7 @@ module mempool_tb;
    ***********************/
 
   initial begin : l2_init
-    automatic axi_data_t mem_row;
-    byte buffer [];
+    bit [AxiDataWidth-1:0] rows [];
     addr_t address;
     addr_t length;
     string binary;
@@ -287,21 +287,23 @@ module mempool_tb;
       void'(read_elf(binary));
       $display("Loading %s", binary);
       while (get_section(address, length)) begin
-        // Read sections
-        automatic int nwords = (length + L2BeWidth - 1)/L2BeWidth;
+        // Read sections as whole L2 rows
+        automatic addr_t first_row = (address - dut.L2MemoryBaseAddr) >> L2ByteOffset;
+        automatic int nrows = (address[L2ByteOffset-1:0] + length + L2BeWidth - 1) / L2BeWidth;
         $display("Loading section %x of length %x", address, length);
-        buffer = new[nwords * L2BeWidth];
-        void'(read_section(address, buffer));
+        if (address < dut.L2MemoryBaseAddr || address + length > dut.L2MemoryEndAddr) begin
+          $display("Cannot initialize address %x, which doesn't fall into the L2 region.", address);
+          continue;
+        end
+        // Sections can share their first and last row with other sections,
+        // start from the current content of those rows
+        rows = new[nrows];
+        rows[0] = dut.l2_mem.init_val[first_row];
+        rows[nrows-1] = dut.l2_mem.init_val[first_row + nrows - 1];
+        void'(read_section_rows(address, rows));
         // Initializing memories
-        for (int w = 0; w < nwords; w++) begin
-          mem_row = '0;
-          for (int b = 0; b < L2BeWidth; b++) begin
-            mem_row[8 * b +: 8] = buffer[w * L2BeWidth + b];
-          end
-          if (address >= dut.L2MemoryBaseAddr && address < dut.L2MemoryEndAddr)
-            dut.l2_mem.init_val[(address - dut.L2MemoryBaseAddr + (w << L2ByteOffset)) >> L2ByteOffset] = mem_row;
-          else
-            $display("Cannot initialize address %x, which doesn't fall into the L2 region.", address);
+        for (int w = 0; w < nrows; w++) begin
+          dut.l2_mem.init_val[first_row + w] = rows[w];
         end
       end
     end
@@ -22,6 +22,9 @@ import "DPI-C" function void probe_response (
   input bit        resp_valid,
   input bit [31:0] resp_id);
 
+import "DPI-C" function void tg_set_num_groups (
+  input int unsigned num_groups);
+
 module traffic_generator
   import mempool_pkg::*;
 #(
@@ -72,6 +75,9 @@ module traffic_generator
   // Cycle count
   logic [31:0] cycle;
 
+  // The traffic generator classifies the requests by the group they target
+  initial tg_set_num_groups(NumGroups);
+
   /*************
    *  Payload  *
    *************/
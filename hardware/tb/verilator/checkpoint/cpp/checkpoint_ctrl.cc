@@ -0,0 +1,141 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "checkpoint_ctrl.h"
+
+#include <getopt.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <iostream>
+
+#include "verilator_sim_ctrl.h"
+
+// Set as soon as any core enables its trace CSR. The cores might report it
+// concurrently in a multi-threaded model.
+static std::atomic<bool> trace_enabled(false);
+
+// DPI Imports, see mempool_cc.sv
+extern "C" {
+void checkpoint_trace_enabled(uint32_t hart_id) { trace_enabled = true; }
+}
+
+// Print a usage message to stdout
+static void PrintHelp() {
+  std::cout << "Checkpoints:\n\n"
+               "--checkpoint-save=FILE\n"
+               "  Save the simulation state to FILE at the trigger given by\n"
+               "  --checkpoint-at\n\n"
+               "--checkpoint-at=trace|CYCLE\n"
+               "  Save at the first write of the trace CSR, i.e., at\n"
+               "  mempool_start_benchmark(), or at CYCLE (default: trace)\n\n"
+               "--checkpoint-exit\n"
+               "  Stop the simulation once the checkpoint is saved\n\n"
+               "--checkpoint-restore=FILE\n"
+               "  Resume the simulation from the checkpoint FILE. The memory\n"
+               "  contents are part of the checkpoint. Text traces are not\n"
+               "  resumed, use binary traces (snitch_trace_binary=1)\n\n";
+}
+
+CheckpointCtrl::CheckpointCtrl()
+    : save_at_trace_(true), save_cycle_(0), save_exit_(false),
+      save_pending_(false), exit_pending_(false) {}
+
+bool CheckpointCtrl::ParseCLIArguments(int argc, char **argv,
+                                       bool &exit_app) {
+  const struct option long_options[] = {
+      {"checkpoint-save", required_argument, nullptr, 'S'},
+      {"checkpoint-at", required_argument, nullptr, 'A'},
+      {"checkpoint-exit", no_argument, nullptr, 'X'},
+      {"checkpoint-restore", required_argument, nullptr, 'R'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, ":h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    switch (c) {
+    case 0:
+      break;
+    case 'S':
+      save_file_ = optarg;
+      break;
+    case 'A':
+      if (std::string(optarg) == "trace") {
+        save_at_trace_ = true;
+      } else {
+        try {
+          save_cycle_ = std::stoul(optarg);
+          save_at_trace_ = false;
+        } catch (const std::exception &) {
+          std::cerr << "ERROR: Invalid checkpoint trigger `" << optarg
+                    << "'." << std::endl;
+          return false;
+        }
+      }
+      break;
+    case 'X':
+      save_exit_ = true;
+      break;
+    case 'R':
+      restore_file_ = optarg;
+      break;
+    case 'h':
+      PrintHelp();
+      return true;
+    case ':': // missing argument
+      std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+      return false;
+    case '?':
+    default:;
+      // Ignore unrecognized options since they might be consumed by
+      // other utils
+    }
+  }
+
+  save_pending_ = !save_file_.empty();
+  return true;
+}
+
+void CheckpointCtrl::PreExec() {
+  if (restore_file_.empty()) {
+    return;
+  }
+
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  if (!simctrl.RestoreCheckpoint(restore_file_)) {
+    simctrl.RequestStop(false);
+  }
+}
+
+void CheckpointCtrl::OnClock(unsigned long sim_time) {
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+
+  // The checkpoint was written at the end of the previous cycle
+  if (exit_pending_) {
+    simctrl.RequestStop(true);
+    exit_pending_ = false;
+    return;
+  }
+
+  if (!save_pending_) {
+    return;
+  }
+  if (save_at_trace_ ? !trace_enabled : sim_time / 2 < save_cycle_) {
+    return;
+  }
+
+  simctrl.RequestCheckpoint(save_file_);
+  save_pending_ = false;
+  exit_pending_ = save_exit_;
+}
@@ -0,0 +1,39 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+//
+// A SimCtrlExtension that saves the state of the simulation at a trigger and
+// restores it in later runs, such that they skip the boot and initialization
+//
+
+#include <string>
+
+#include "sim_ctrl_extension.h"
+
+class CheckpointCtrl : public SimCtrlExtension {
+public:
+  CheckpointCtrl();
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void PreExec() override;
+  void OnClock(unsigned long sim_time) override;
+
+private:
+  // Checkpoint to write, none if empty
+  std::string save_file_;
+  // Checkpoint to start from, none if empty
+  std::string restore_file_;
+
+  // Save at the first write of the trace CSR or at save_cycle_
+  bool save_at_trace_;
+  unsigned long save_cycle_;
+  // Stop the simulation once the checkpoint is written
+  bool save_exit_;
+
+  bool save_pending_;
+  bool exit_pending_;
+};
@@ -9,6 +9,7 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
 #include <iostream>
@@ -33,6 +34,39 @@ extern void simutil_memload(const char *file);
  * @return 1 if successful, 0 otherwise
  */
 extern int simutil_set_mem(int index, const svBitVecVal *val);
+
+/**
+ * Write |num_words| words starting at index |index| to memory, fetching each
+ * word with simutil_get_segment_word() from the opaque handle |data|
+ *
+ * @return 1 if successful, 0 otherwise
+ */
+extern int simutil_set_mem_segment(int index, int num_words, void *data);
+}
+
+namespace {
+// A segment of data handed to simutil_set_mem_segment
+struct MemSegment {
+  const uint8_t *data;
+  size_t size;
+  uint32_t width_byte;
+};
+} // namespace
+
+// DPI Imports
+extern "C" {
+
+/**
+ * Copy word |index| of the MemSegment |data| to |val|, zero-padding the last
+ * word of the segment if it is only partially covered by data
+ */
+void simutil_get_segment_word(void *data, int index, svBitVecVal *val) {
+  const MemSegment *seg = static_cast<const MemSegment *>(data);
+  size_t offset = (size_t)index * seg->width_byte;
+  size_t len = std::min<size_t>(seg->width_byte, seg->size - offset);
+  memcpy(val, seg->data + offset, len);
+  memset((uint8_t *)val + len, 0, 32 - len);
+}
 }
 
 namespace {
@@ -264,47 +298,21 @@ static void WriteSegment(const MemArea &m, uint32_t offset,
   // be caught at this function's callsite.
   SVScoped scoped(m.location.data());
 
-  // This "mini buffer" is used to transfer each write to SystemVerilog. It's
-  // not massively efficient, but doing so ensures that we pass 256 bits (32
-  // bytes) of initialised data each time. This is for simutil_set_mem (defined
-  // in prim_util_memload.svh), whose "val" argument has SystemVerilog type bit
-  // [255:0].
-  uint8_t minibuf[32];
-  memset(minibuf, 0, sizeof minibuf);
-  assert(m.width_byte <= sizeof minibuf);
-
-  uint32_t full_data_words = data.size() / m.width_byte;
-  uint32_t part_data_word_len = data.size() % m.width_byte;
-  bool has_part_data_word = part_data_word_len != 0;
-
+  // Hand the whole segment to SystemVerilog in a single call. The memory pulls
+  // the words through simutil_get_segment_word, which is a plain function call
+  // in contrast to entering an exported function for every word.
+  MemSegment seg = {.data = data.data(),
+                    .size = data.size(),
+                    .width_byte = m.width_byte};
+  uint32_t num_words = (data.size() + m.width_byte - 1) / m.width_byte;
   uint32_t word_offset = offset / m.width_byte;
 
-  // Copy the full data words
-  for (uint32_t i = 0; i < full_data_words; ++i) {
-    uint32_t dst_word = word_offset + i;
-    uint32_t src_byte = i * m.width_byte;
-    memcpy(minibuf, &data[src_byte], m.width_byte);
-    if (!simutil_set_mem(dst_word, (svBitVecVal *)minibuf)) {
-      std::ostringstream oss;
-      oss << "Could not set `" << m.name << "' memory at byte offset 0x"
-          << std::hex << dst_word * m.width_byte << ".";
-      throw std::runtime_error(oss.str());
-    }
-  }
-
-  // Copy any partial data, zeroing minibuf first to ensure that the latter
-  // bytes in the word are zero.
-  if (has_part_data_word) {
-    memset(minibuf, 0, sizeof minibuf);
-    uint32_t dst_word = word_offset + full_data_words;
-    uint32_t src_byte = full_data_words * m.width_byte;
-    memcpy(minibuf, &data[src_byte], part_data_word_len);
-    if (!simutil_set_mem(dst_word, (svBitVecVal *)minibuf)) {
-      std::ostringstream oss;
-      oss << "Could not set `" << m.name << "' memory at byte offset 0x"
-          << std::hex << dst_word * m.width_byte << " (partial data word).";
-      throw std::runtime_error(oss.str());
-    }
+  if (!simutil_set_mem_segment(word_offset, num_words, &seg)) {
+    std::ostringstream oss;
+    oss << "Could not set `" << m.name << "' memory at byte offset 0x"
+        << std::hex << offset << " (segment of 0x" << data.size()
+        << " bytes).";
+    throw std::runtime_error(oss.str());
   }
 }
 
@@ -571,6 +579,22 @@ void DpiMemUtil::LoadElfToMemories(bool verbose, const std::string &filepath) {
   }
 }
 
+void DpiMemUtil::ClearMemories() {
+  for (const auto &pr : name_to_mem_) {
+    const MemArea &mem_area = pr.second;
+    if (!mem_area.addr_loc.size)
+      continue;
+    try {
+      WriteSegment(mem_area, 0,
+                   std::vector<uint8_t>(mem_area.addr_loc.size, 0));
+    } catch (const SVScoped::Error &err) {
+      std::cout << "No memory found at `" << err.scope_name_
+                << "' (the scope associated with region `" << mem_area.name
+                << "').";
+    }
+  }
+}
+
 void DpiMemUtil::StageElf(bool verbose, const std::string &path) {
   // Clear out anything that was in the staging area before
   staging_area_.clear();
@@ -68,8 +68,9 @@ private:
  *
  * These utilities require the corresponding DPI functions:
  * simutil_memload()
- * simutil_set_mem()
- * to be defined somewhere as SystemVerilog functions.
+ * simutil_set_mem_segment()
+ * to be defined somewhere as SystemVerilog functions. In turn, they provide
+ * the DPI import simutil_get_segment_word() to the memories.
  */
 class DpiMemUtil {
 public:
@@ -79,8 +80,8 @@ public:
    * The |name| must be a unique identifier. The function will return false if
    * |name| is already used. |location| is the path to the scope of the
    * instantiated memory, which needs to support the DPI-C interfaces
-   * 'simutil_memload' and 'simutil_set_mem' used for 'vmem' and 'elf' files,
-   * respectively.
+   * 'simutil_memload' and 'simutil_set_mem_segment' used for 'vmem' and 'elf'
+   * files, respectively.
    *
    * The |width_bit| argument specifies the with in bits of the target memory
    * instance (used for packing data). This must be a multiple of 8. If
@@ -132,6 +133,12 @@ public:
    */
   void LoadElfToMemories(bool verbose, const std::string &filepath);
 
+  /**
+   * Zero every memory whose address location is known, e.g., before loading
+   * the next program.
+   */
+  void ClearMemories();
+
   /**
    * Load an ELF file into a staging area in this object, which can then be
    * accessed with GetMemoryData().
@@ -14,6 +14,8 @@
 #include <string>
 #include <vector>
 
+#include "verilator_sim_ctrl.h"
+
 namespace {
 // An instruction to load the file at filepath to the memory called name. If
 // name is the empty string then type must be kMemImageElf and this is an
@@ -77,6 +79,13 @@ static void PrintHelp() {
                "  TYPE is either 'elf' or 'vmem'\n\n"
                "-E|--load-elf=FILE\n"
                "  Load ELF file, using segment LMAs to pick memory regions\n\n"
+               "--run-elf=FILE\n"
+               "  Load ELF file like --load-elf and run it until $finish. If "
+               "given\n"
+               "  several times, the programs run back to back, resetting the\n"
+               "  design and zeroing the registered memories (L2) in between.\n"
+               "  The L1 keeps its contents, like after a reset of the\n"
+               "  hardware, so its NOLOAD sections are not zero-initialized\n\n"
                "-l list|--meminit=list\n"
                "  Print registered memory regions\n\n"
                "--verbose-mem-load\n"
@@ -85,11 +94,15 @@ static void PrintHelp() {
                "  Show help\n\n";
 }
 
-VerilatorMemUtil::VerilatorMemUtil() : allocation_(new DpiMemUtil()) {
+VerilatorMemUtil::VerilatorMemUtil()
+    : allocation_(new DpiMemUtil()), current_program_(0),
+      load_pending_(false), verbose_(false) {
   mem_util_ = allocation_.get();
 }
 
-VerilatorMemUtil::VerilatorMemUtil(DpiMemUtil *mem_util) : mem_util_(mem_util) {
+VerilatorMemUtil::VerilatorMemUtil(DpiMemUtil *mem_util)
+    : mem_util_(mem_util), current_program_(0), load_pending_(false),
+      verbose_(false) {
   assert(mem_util);
 }
 
@@ -102,11 +115,13 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
       {"meminit", required_argument, nullptr, 'l'},
       {"verbose-mem-load", no_argument, nullptr, 'V'},
       {"load-elf", required_argument, nullptr, 'E'},
+      {"run-elf", required_argument, nullptr, 'P'},
       {"help", no_argument, nullptr, 'h'},
       {nullptr, no_argument, nullptr, 0}};
 
   std::vector<LoadArg> load_args;
   bool verbose = false;
+  programs_.clear();
 
   // Reset the command parsing index in-case other utils have already parsed
   // some arguments
@@ -157,6 +172,9 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
       load_args.push_back(
           {.name = "", .filepath = optarg, .type = kMemImageElf});
       break;
+    case 'P':
+      programs_.push_back(optarg);
+      break;
     case 'h':
       PrintHelp();
       return true;
@@ -170,6 +188,15 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
     }
   }
 
+  // The first program is loaded right away, after all other images
+  if (!programs_.empty()) {
+    load_args.push_back(
+        {.name = "", .filepath = programs_[0], .type = kMemImageElf});
+  }
+  current_program_ = 0;
+  load_pending_ = false;
+  verbose_ = verbose;
+
   for (const LoadArg &arg : load_args) {
     try {
       if (!arg.name.empty()) {
@@ -187,3 +214,44 @@ bool VerilatorMemUtil::ParseCLIArguments(int argc, char **argv,
 
   return true;
 }
+
+void VerilatorMemUtil::OnClock(unsigned long sim_time) {
+  if (!load_pending_) {
+    return;
+  }
+
+  // Load the next program while the design is held in reset, such that the
+  // cores of the previous program cannot overwrite it anymore
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  if (sim_time / 2 + 1 < simctrl.GetResetEndCycle()) {
+    return;
+  }
+  load_pending_ = false;
+
+  const std::string &filepath = programs_[current_program_];
+  std::cout << "Running program " << current_program_ + 1 << " of "
+            << programs_.size() << ": " << filepath << std::endl;
+  try {
+    // Drop the data of the previous program
+    mem_util_->ClearMemories();
+    mem_util_->LoadElfToMemories(verbose_, filepath);
+  } catch (const std::exception &err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    simctrl.RequestStop(false);
+  }
+}
+
+bool VerilatorMemUtil::OnFinish() {
+  // The design might finish again before the reset kicks in
+  if (load_pending_) {
+    return true;
+  }
+  if (current_program_ + 1 >= programs_.size()) {
+    return false;
+  }
+
+  current_program_++;
+  load_pending_ = true;
+  VerilatorSimCtrl::GetInstance().RequestReset();
+  return true;
+}
@@ -9,6 +9,8 @@
 //
 
 #include <memory>
+#include <string>
+#include <vector>
 
 #include "dpi_memutil.h"
 #include "sim_ctrl_extension.h"
@@ -22,6 +24,8 @@ public:
 
   // Declared in SimCtrlExtension
   bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void OnClock(unsigned long sim_time) override;
+  bool OnFinish() override;
 
   // Get underlying DpiMemUtil object
   DpiMemUtil *GetUnderlying() { return mem_util_; }
@@ -39,4 +43,10 @@ public:
 private:
   DpiMemUtil *mem_util_;
   std::unique_ptr<DpiMemUtil> allocation_;
+
+  // Programs run back to back, see --run-elf
+  std::vector<std::string> programs_;
+  size_t current_program_;
+  bool load_pending_;
+  bool verbose_;
 };
@@ -32,6 +32,14 @@ public:
    */
   virtual void OnClock(unsigned long sim_time) {}
 
+  /**
+   * Function to be called when the design calls $finish
+   *
+   * @return true to resume the simulation instead of ending it, e.g., after
+   *         requesting a reset
+   */
+  virtual bool OnFinish() { return false; }
+
   /**
    * Function to be called after executing the simulation
    */
@@ -90,6 +90,11 @@ public:
 };
 #endif // VM_TRACE == 1
 
+// CHECKPOINT must be set by the user when calling Verilator with --savable
+#ifdef CHECKPOINT
+#include "verilated_save.h"
+#endif
+
 // Forward-declare for use in VerilatedToplevel
 class TOPLEVEL_NAME;
 
@@ -122,6 +127,10 @@ public:
   virtual void final() = 0;
   virtual const char *name() const = 0;
   virtual void trace(VerilatedTracer &tfp, int levels, int options) = 0;
+#ifdef CHECKPOINT
+  virtual void save(VerilatedSerialize &os) = 0;
+  virtual void restore(VerilatedDeserialize &os) = 0;
+#endif
 
   /**
    * Get the Verilator-generated device under test
@@ -150,6 +159,14 @@ public:
     assert(0 && "Tracing not enabled.");
 #endif
   }
+#ifdef CHECKPOINT
+  void save(VerilatedSerialize &os) {
+    os << static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+  }
+  void restore(VerilatedDeserialize &os) {
+    os >> static_cast<VERILATED_TOPLEVEL_NAME &>(*this);
+  }
+#endif
 };
 
 #endif // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATED_TOPLEVEL_H_
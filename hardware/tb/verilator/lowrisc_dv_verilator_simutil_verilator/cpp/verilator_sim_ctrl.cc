@@ -165,15 +165,74 @@ void VerilatorSimCtrl::RequestStop(bool simulation_success) {
   simulation_success_ &= simulation_success;
 }
 
+void VerilatorSimCtrl::RequestReset() {
+  start_reset_cycle_ = time_ / 2 + 1;
+  end_reset_cycle_ = start_reset_cycle_ + reset_duration_cycles_;
+}
+
+void VerilatorSimCtrl::RequestCheckpoint(const std::string &filename) {
+  checkpoint_file_ = filename;
+}
+
+bool VerilatorSimCtrl::RestoreCheckpoint(const std::string &filename) {
+  assert(top_ && "Use SetTop() first.");
+#ifdef CHECKPOINT
+  VerilatedRestore os;
+  os.open(filename.c_str());
+  if (!os.isOpen()) {
+    std::cerr << "ERROR: Cannot open checkpoint `" << filename << "'."
+              << std::endl;
+    return false;
+  }
+  vluint64_t time;
+  os >> time;
+  top_->restore(os);
+  time_ = time;
+  os.close();
+  std::cout << "Restored checkpoint `" << filename << "' at cycle "
+            << time_ / 2 << "." << std::endl;
+  return true;
+#else
+  std::cerr << "ERROR: Checkpoints are not supported by this model, rebuild "
+               "it with checkpoint=1."
+            << std::endl;
+  return false;
+#endif
+}
+
+void VerilatorSimCtrl::WriteCheckpoint() {
+#ifdef CHECKPOINT
+  VerilatedSave os;
+  os.open(checkpoint_file_.c_str());
+  if (os.isOpen()) {
+    vluint64_t time = time_;
+    os << time;
+    top_->save(os);
+    os.close();
+    std::cout << "Wrote checkpoint `" << checkpoint_file_ << "' at cycle "
+              << time_ / 2 << "." << std::endl;
+  } else {
+    std::cerr << "ERROR: Cannot open checkpoint `" << checkpoint_file_
+              << "' for writing." << std::endl;
+  }
+#else
+  std::cerr << "ERROR: Checkpoints are not supported by this model, rebuild "
+               "it with checkpoint=1."
+            << std::endl;
+#endif
+  checkpoint_file_.clear();
+}
+
 void VerilatorSimCtrl::RegisterExtension(SimCtrlExtension *ext) {
   extension_array_.push_back(ext);
 }
 
 VerilatorSimCtrl::VerilatorSimCtrl()
-    : top_(nullptr), time_(0), tracing_enabled_(false),
+    : top_(nullptr), time_(0), time_run_begin_(0), tracing_enabled_(false),
       tracing_enabled_changed_(false), tracing_ever_enabled_(false),
       tracing_possible_(VM_TRACE), initial_reset_delay_cycles_(2),
-      reset_duration_cycles_(2), request_stop_(false),
+      reset_duration_cycles_(2), start_reset_cycle_(0), end_reset_cycle_(0),
+      request_stop_(false),
       simulation_success_(true), tracer_(VerilatedTracer()),
       term_after_cycles_(0) {}
 
@@ -240,17 +299,22 @@ bool VerilatorSimCtrl::TraceOff() {
 }
 
 void VerilatorSimCtrl::PrintStatistics() const {
-  double speed_hz = time_ / 2 / (GetExecutionTimeMs() / 1000.0);
+  // A restored simulation only executed the cycles after the checkpoint
+  unsigned long cycles = (time_ - time_run_begin_) / 2;
+  double speed_hz = cycles / (GetExecutionTimeMs() / 1000.0);
   double speed_khz = speed_hz / 1000.0;
 
   std::cout << std::endl
             << "Simulation statistics" << std::endl
             << "=====================" << std::endl
-            << "Executed cycles:  " << time_ / 2 << std::endl
+            << "Executed cycles:  " << cycles << std::endl
             << "Wallclock time:   " << GetExecutionTimeMs() / 1000.0 << " s"
             << std::endl
             << "Simulation speed: " << speed_hz << " cycles/s "
             << "(" << speed_khz << " kHz)" << std::endl;
+#ifdef VERILATOR_THREADS
+  std::cout << "Model threads:    " << VERILATOR_THREADS << std::endl;
+#endif
 
   int trace_size_byte;
   if (tracing_enabled_ && FileSize(GetTraceFileName(), trace_size_byte)) {
@@ -282,11 +346,12 @@ void VerilatorSimCtrl::Run() {
             << "Simulation running, end by pressing CTRL-c." << std::endl;
 
   time_begin_ = std::chrono::steady_clock::now();
+  time_run_begin_ = time_;
   UnsetReset();
   Trace();
 
-  unsigned long start_reset_cycle_ = initial_reset_delay_cycles_;
-  unsigned long end_reset_cycle_ = start_reset_cycle_ + reset_duration_cycles_;
+  start_reset_cycle_ = initial_reset_delay_cycles_;
+  end_reset_cycle_ = start_reset_cycle_ + reset_duration_cycles_;
 
   while (1) {
     unsigned long cycle_ = time_ / 2;
@@ -312,15 +377,31 @@ void VerilatorSimCtrl::Run() {
 
     Trace();
 
+    // The state is consistent after evaluating both clock edges
+    if (!checkpoint_file_.empty() && !*sig_clk_) {
+      WriteCheckpoint();
+    }
+
     if (request_stop_) {
       std::cout << "Received stop request, shutting down simulation."
                 << std::endl;
       break;
     }
     if (Verilated::gotFinish()) {
-      std::cout << "Received $finish() from Verilog, shutting down simulation."
-                << std::endl;
-      break;
+      // Extensions can take over the $finish, e.g., to run another program
+      bool resume = false;
+      for (auto it = extension_array_.begin(); it != extension_array_.end();
+           ++it) {
+        resume |= (*it)->OnFinish();
+      }
+      if (resume) {
+        Verilated::gotFinish(false);
+      } else {
+        std::cout
+            << "Received $finish() from Verilog, shutting down simulation."
+            << std::endl;
+        break;
+      }
     }
     if (term_after_cycles_ && (time_ / 2 >= term_after_cycles_)) {
       std::cout << "Simulation timeout of " << term_after_cycles_
@@ -102,6 +102,42 @@ public:
    */
   void RequestStop(bool simulation_success);
 
+  /**
+   * Request the reset signal to be pulsed again
+   *
+   * The reset is asserted on the next clock cycle and kept active for the
+   * configured reset duration. The simulation continues afterwards.
+   *
+   * @see SetResetDuration()
+   */
+  void RequestReset();
+
+  /**
+   * Get the cycle at which the last requested reset is released
+   */
+  unsigned long GetResetEndCycle() const { return end_reset_cycle_; }
+
+  /**
+   * Request a checkpoint of the simulation state
+   *
+   * The state is written to |filename| at the end of the current cycle. This
+   * requires a model built with Verilator's --savable.
+   *
+   * @see RestoreCheckpoint()
+   */
+  void RequestCheckpoint(const std::string &filename);
+
+  /**
+   * Restore the simulation state from a checkpoint
+   *
+   * The checkpoint must have been written by a model built from the same
+   * sources. Call this function before the simulation runs, e.g., in
+   * SimCtrlExtension::PreExec().
+   *
+   * @return true if the state was restored
+   */
+  bool RestoreCheckpoint(const std::string &filename);
+
   /**
    * Register an extension to be called automatically
    */
@@ -118,12 +154,16 @@ private:
   CData *sig_rst_;
   VerilatorSimCtrlFlags flags_;
   unsigned long time_;
+  unsigned long time_run_begin_;
+  std::string checkpoint_file_;
   bool tracing_enabled_;
   bool tracing_enabled_changed_;
   bool tracing_ever_enabled_;
   bool tracing_possible_;
   unsigned int initial_reset_delay_cycles_;
   unsigned int reset_duration_cycles_;
+  unsigned long start_reset_cycle_;
+  unsigned long end_reset_cycle_;
   volatile unsigned int request_stop_;
   volatile bool simulation_success_;
   std::chrono::steady_clock::time_point time_begin_;
@@ -238,6 +278,11 @@ private:
    * Perform tracing in Verilator if required
    */
   void Trace();
+
+  /**
+   * Write a requested checkpoint
+   */
+  void WriteCheckpoint();
 };
 
 #endif // OPENTITAN_HW_DV_VERILATOR_SIMUTIL_VERILATOR_CPP_VERILATOR_SIM_CTRL_H_
@@ -5,6 +5,12 @@
 #include <fstream>
 #include <iostream>
 
+#ifdef CHECKPOINT
+#include "checkpoint_ctrl.h"
+#endif
+#ifdef TRAFFIC_GEN
+#include "traffic_generator_ctrl.h"
+#endif
 #include "verilated_toplevel.h"
 #include "verilator_memutil.h"
 #include "verilator_sim_ctrl.h"
@@ -16,9 +22,6 @@
 #define L2_SIZE 0x00080000
 #endif
 
-// Histogram printing function
-extern "C" void print_histogram();
-
 int main(int argc, char **argv) {
   mempool_tb_verilator top;
   VerilatorMemUtil memutil;
@@ -31,6 +34,13 @@ int main(int argc, char **argv) {
   memutil.RegisterMemoryArea("ram", "TOP.mempool_tb_verilator.dut.l2_mem", 128,
                              &l2_mem);
   simctrl.RegisterExtension(&memutil);
+#else
+  TrafficGeneratorCtrl tgctrl;
+  simctrl.RegisterExtension(&tgctrl);
+#endif
+#ifdef CHECKPOINT
+  CheckpointCtrl ckptctrl;
+  simctrl.RegisterExtension(&ckptctrl);
 #endif
 
   simctrl.SetInitialResetDelay(5);
@@ -48,11 +58,6 @@ int main(int argc, char **argv) {
 
   simctrl.RunSimulation();
 
-#ifdef TRAFFIC_GEN
-  // Print the latency histogram
-  print_histogram();
-#endif
-
   if (!simctrl.WasSimulationSuccessful()) {
     return 1;
   }
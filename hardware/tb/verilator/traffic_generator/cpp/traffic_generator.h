@@ -0,0 +1 @@
+../../../dpi/traffic_generator.h
\ No newline at end of file
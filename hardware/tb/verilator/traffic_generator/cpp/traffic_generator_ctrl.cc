@@ -0,0 +1,345 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include "traffic_generator_ctrl.h"
+
+#include <getopt.h>
+
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include "verilator_sim_ctrl.h"
+
+// Parse a sweep range of the form start[:stop[:step]]. The stop value is
+// inclusive. Throw a std::runtime_error if something looks wrong.
+static std::vector<float> ParseRange(const std::string &range) {
+  std::vector<float> bounds;
+  std::istringstream iss(range);
+  std::string field;
+
+  while (std::getline(iss, field, ':')) {
+    try {
+      bounds.push_back(std::stof(field));
+    } catch (const std::exception &) {
+      throw std::runtime_error("invalid number `" + field + "' in range `" +
+                               range + "'.");
+    }
+  }
+
+  if (bounds.empty() || bounds.size() > 3) {
+    throw std::runtime_error("range must be in the format "
+                             "`start[:stop[:step]]'. Got: `" +
+                             range + "'.");
+  }
+
+  float start = bounds[0];
+  float stop = bounds.size() > 1 ? bounds[1] : start;
+  float step = bounds.size() > 2 ? bounds[2] : 1;
+  if (stop < start || step <= 0) {
+    throw std::runtime_error("empty range `" + range + "'.");
+  }
+
+  // Count the points with some slack to absorb rounding errors
+  std::vector<float> values;
+  unsigned int count = std::floor((stop - start) / step + 1e-4) + 1;
+  for (unsigned int i = 0; i < count; i++) {
+    values.push_back(start + i * step);
+  }
+  return values;
+}
+
+// Print a usage message to stdout
+static void PrintHelp() {
+  std::cout << "Traffic generator:\n\n"
+               "--tg-req-prob=P\n"
+               "  Probability of a core issuing a request each cycle\n\n"
+               "--tg-seq-prob=P\n"
+               "  Probability of a request targeting the local sequential "
+               "region\n\n"
+               "--tg-ncycles=N\n"
+               "  Generate traffic for N cycles after reset\n\n"
+               "--tg-pattern=NAME[,KEY=VALUE...]\n"
+               "  Address pattern of the requests (default: uniform)\n"
+               "    uniform                       Uniformly random, see "
+               "--tg-seq-prob\n"
+               "    strided,stride=W,offset=W     Core c accesses word c*offset "
+               "+ n*stride\n"
+               "    matmul,dim=N,block=B          Tiled NxN matrix "
+               "multiplication\n"
+               "    hotspot,prob=P,bank=B|tile=T  Fraction P of requests to a "
+               "hot bank/tile\n"
+               "    stencil,width=W,height=H      5-point 2D stencil\n"
+               "    trace,dir=DIR                 Replay the TCDM accesses of "
+               "DIR/trace_hart_*.dasm\n\n"
+               "--tg-window=N\n"
+               "  Measure the throughput over windows of N cycles\n\n"
+               "--tg-stats=FILE\n"
+               "  Write detailed statistics as JSON to FILE. Sweeps append "
+               "the\n"
+               "  index of the load point to the file name\n\n"
+               "--tg-seed=N\n"
+               "  Seed the random number generator with N\n\n"
+               "--tg-sweep-req-prob=START[:STOP[:STEP]]\n"
+               "--tg-sweep-seq-prob=START[:STOP[:STEP]]\n"
+               "  Sweep over all combinations of the given probabilities,\n"
+               "  resetting the design between load points\n\n"
+               "--tg-sweep-out=FILE\n"
+               "  Write the sweep results as CSV to FILE (default: "
+               "tg_sweep.csv)\n\n";
+}
+
+TrafficGeneratorCtrl::TrafficGeneratorCtrl()
+    : req_prob_(0.2), seq_prob_(0), ncycles_(10000),
+      sweep_out_("tg_sweep.csv"), current_point_(0), restart_pending_(false) {
+}
+
+bool TrafficGeneratorCtrl::ParseCLIArguments(int argc, char **argv,
+                                             bool & /* exit_app */) {
+  const struct option long_options[] = {
+      {"tg-req-prob", required_argument, nullptr, 'R'},
+      {"tg-seq-prob", required_argument, nullptr, 'S'},
+      {"tg-ncycles", required_argument, nullptr, 'N'},
+      {"tg-pattern", required_argument, nullptr, 'P'},
+      {"tg-window", required_argument, nullptr, 'W'},
+      {"tg-stats", required_argument, nullptr, 'J'},
+      {"tg-seed", required_argument, nullptr, 'D'},
+      {"tg-sweep-req-prob", required_argument, nullptr, 'r'},
+      {"tg-sweep-seq-prob", required_argument, nullptr, 's'},
+      {"tg-sweep-out", required_argument, nullptr, 'o'},
+      {"help", no_argument, nullptr, 'h'},
+      {nullptr, no_argument, nullptr, 0}};
+
+  // Reset the command parsing index in-case other utils have already parsed
+  // some arguments
+  optind = 1;
+  while (1) {
+    int c = getopt_long(argc, argv, ":h", long_options, nullptr);
+    if (c == -1) {
+      break;
+    }
+
+    // Disable error reporting by getopt
+    opterr = 0;
+
+    try {
+      switch (c) {
+      case 0:
+        break;
+      case 'R':
+        req_prob_ = std::stof(optarg);
+        break;
+      case 'S':
+        seq_prob_ = std::stof(optarg);
+        break;
+      case 'N':
+        ncycles_ = std::stoul(optarg);
+        break;
+      case 'P':
+        if (!tg_set_pattern(optarg)) {
+          return false;
+        }
+        break;
+      case 'W':
+        tg_set_window(std::stoul(optarg));
+        break;
+      case 'J':
+        stats_out_ = optarg;
+        break;
+      case 'D':
+        tg_seed(std::stoul(optarg));
+        break;
+      case 'r':
+        sweep_req_prob_ = ParseRange(optarg);
+        break;
+      case 's':
+        sweep_seq_prob_ = ParseRange(optarg);
+        break;
+      case 'o':
+        sweep_out_ = optarg;
+        break;
+      case 'h':
+        PrintHelp();
+        return true;
+      case ':': // missing argument
+        std::cerr << "ERROR: Missing argument." << std::endl << std::endl;
+        return false;
+      case '?':
+      default:;
+        // Ignore unrecognized options since they might be consumed by
+        // other utils
+      }
+    } catch (const std::exception &err) {
+      std::cerr << "ERROR: Invalid traffic generator argument: " << err.what()
+                << std::endl;
+      return false;
+    }
+  }
+
+  // Without a sweep range, the single-run parameter is used
+  if (sweep_req_prob_.empty()) {
+    sweep_req_prob_.push_back(req_prob_);
+  }
+  if (sweep_seq_prob_.empty()) {
+    sweep_seq_prob_.push_back(seq_prob_);
+  }
+
+  points_.clear();
+  for (float seq_prob : sweep_seq_prob_) {
+    for (float req_prob : sweep_req_prob_) {
+      LoadPoint point = LoadPoint();
+      point.seq_prob = seq_prob;
+      point.req_prob = req_prob;
+      points_.push_back(point);
+    }
+  }
+
+  return true;
+}
+
+void TrafficGeneratorCtrl::PreExec() {
+  if (Sweeping()) {
+    std::cout << "Sweeping the traffic generator over " << points_.size()
+              << " load points of " << ncycles_ << " cycles each."
+              << std::endl;
+  }
+
+  // Traffic generated before the initial reset is discarded as well
+  tg_set_ncycles(ncycles_);
+  current_point_ = 0;
+  StartPoint();
+  restart_pending_ = true;
+}
+
+void TrafficGeneratorCtrl::OnClock(unsigned long sim_time) {
+  VerilatorSimCtrl &simctrl = VerilatorSimCtrl::GetInstance();
+  unsigned long cycle = sim_time / 2;
+  unsigned long reset_end_cycle = simctrl.GetResetEndCycle();
+
+  // Reconfigure the traffic generator while the design is held in reset,
+  // such that no request of the previous load point survives
+  if (restart_pending_) {
+    if (cycle + 1 >= reset_end_cycle) {
+      StartPoint();
+      restart_pending_ = false;
+    }
+    return;
+  }
+
+  if (cycle != reset_end_cycle + ncycles_) {
+    return;
+  }
+
+  FinishPoint();
+  if (++current_point_ < points_.size()) {
+    simctrl.RequestReset();
+    restart_pending_ = true;
+  } else {
+    simctrl.RequestStop(true);
+  }
+}
+
+void TrafficGeneratorCtrl::PostExec() {
+  if (!Sweeping()) {
+    print_histogram();
+    WriteStats();
+    return;
+  }
+
+  if (current_point_ < points_.size()) {
+    std::cerr << "WARNING: Sweep interrupted after " << current_point_
+              << " of " << points_.size() << " load points." << std::endl;
+  }
+  WriteResults();
+}
+
+void TrafficGeneratorCtrl::StartPoint() {
+  const LoadPoint &point = points_[current_point_];
+
+  tg_reset();
+  tg_configure(point.req_prob, point.seq_prob);
+}
+
+void TrafficGeneratorCtrl::FinishPoint() {
+  LoadPoint &point = points_[current_point_];
+
+  for (int d = 0; d <= TG_NUM_DISTANCES; d++) {
+    tg_statistics(tg_distance_t(d), &point.stats[d]);
+  }
+
+  if (Sweeping()) {
+    const tg_stats_t &stats = point.stats[TG_ALL_DISTANCES];
+    std::cout << "Seq. Probability: " << point.seq_prob
+              << " | Req. Probability: " << point.req_prob
+              << " | Avg. Latency: " << stats.avg_latency << " cycle"
+              << " | P99 Latency: " << stats.p99_latency << " cycle"
+              << " | Throughput: " << stats.throughput << " req/core/cycle"
+              << std::endl;
+    WriteStats();
+  }
+}
+
+void TrafficGeneratorCtrl::WriteStats() const {
+  if (stats_out_.empty()) {
+    return;
+  }
+
+  // Insert the index of the load point before the file extension
+  std::string filename = stats_out_;
+  if (Sweeping()) {
+    size_t dot = filename.rfind('.');
+    size_t slash = filename.rfind('/');
+    if (dot == std::string::npos ||
+        (slash != std::string::npos && dot < slash)) {
+      dot = filename.size();
+    }
+    filename.insert(dot, "_" + std::to_string(current_point_));
+  }
+
+  if (tg_write_stats(filename.c_str())) {
+    std::cout << "Traffic statistics written to " << filename << std::endl;
+  }
+}
+
+bool TrafficGeneratorCtrl::WriteResults() const {
+  std::ofstream out(sweep_out_);
+  if (!out) {
+    std::cerr << "ERROR: Cannot open `" << sweep_out_ << "' for writing."
+              << std::endl;
+    return false;
+  }
+
+  // One group of columns for all transactions and for each distance
+  const tg_distance_t distances[] = {TG_ALL_DISTANCES, TG_LOCAL_TILE,
+                                     TG_SAME_GROUP, TG_REMOTE_GROUP};
+  const char *prefixes[] = {"local_tile_", "same_group_", "remote_group_", ""};
+  out << "seq_prob,req_prob,cycles";
+  for (tg_distance_t d : distances) {
+    for (const char *column :
+         {"transactions", "avg_latency", "p50_latency", "p90_latency",
+          "p99_latency", "max_latency", "throughput"}) {
+      out << "," << prefixes[d] << column;
+    }
+  }
+  out << std::endl;
+
+  for (size_t i = 0; i < current_point_ && i < points_.size(); i++) {
+    const LoadPoint &point = points_[i];
+    out << point.seq_prob << "," << point.req_prob << ","
+        << point.stats[TG_ALL_DISTANCES].cycles;
+    for (tg_distance_t d : distances) {
+      const tg_stats_t &stats = point.stats[d];
+      out << "," << stats.transactions << "," << stats.avg_latency << ","
+          << stats.p50_latency << "," << stats.p90_latency << ","
+          << stats.p99_latency << "," << stats.max_latency << ","
+          << stats.throughput;
+    }
+    out << std::endl;
+  }
+
+  std::cout << "Sweep results written to " << sweep_out_ << std::endl;
+  return true;
+}
@@ -0,0 +1,67 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+//
+// A SimCtrlExtension that configures the traffic generator DPI at runtime and
+// sweeps it over several load points within one simulation run
+//
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "sim_ctrl_extension.h"
+#include "traffic_generator.h"
+
+class TrafficGeneratorCtrl : public SimCtrlExtension {
+public:
+  TrafficGeneratorCtrl();
+
+  // Declared in SimCtrlExtension
+  bool ParseCLIArguments(int argc, char **argv, bool &exit_app) override;
+  void PreExec() override;
+  void OnClock(unsigned long sim_time) override;
+  void PostExec() override;
+
+private:
+  // One load point of the sweep
+  struct LoadPoint {
+    float seq_prob;
+    float req_prob;
+    tg_stats_t stats[TG_NUM_DISTANCES + 1];
+  };
+
+  // Parameters of a single run
+  float req_prob_;
+  float seq_prob_;
+  uint32_t ncycles_;
+
+  // Sweep ranges, a single value if no sweep was requested
+  std::vector<float> sweep_req_prob_;
+  std::vector<float> sweep_seq_prob_;
+  std::string sweep_out_;
+
+  // Detailed statistics, none if empty
+  std::string stats_out_;
+
+  std::vector<LoadPoint> points_;
+  size_t current_point_;
+  bool restart_pending_;
+
+  bool Sweeping() const { return points_.size() > 1; }
+
+  // Configure the traffic generator for the current load point
+  void StartPoint();
+
+  // Collect the statistics of the current load point
+  void FinishPoint();
+
+  // Write the results of all finished load points
+  bool WriteResults() const;
+
+  // Write the detailed statistics of the current load point
+  void WriteStats() const;
+};
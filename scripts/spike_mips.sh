@@ -0,0 +1,40 @@
+#!/usr/bin/env bash
+
+# Copyright 2021 ETH Zurich and University of Bologna.
+# Licensed under the Apache License, Version 2.0, see LICENSE for details.
+# SPDX-License-Identifier: Apache-2.0
+
+# Compares the simulation speed of Spike's MemPool model in MIPS with and
+# without the basic-block cache (--block-cache). The applications are those of software/bin,
+# or those given as arguments. Spike's options can be set with SPIKE_FLAGS,
+# e.g., SPIKE_FLAGS=-p16.
+
+MEMPOOL_DIR=$(git rev-parse --show-toplevel 2>/dev/null || echo $MEMPOOL_DIR)
+spike=${SPIKE:-$MEMPOOL_DIR/install/riscv-isa-sim/bin/spike}
+runs=${RUNS:-3}
+
+if [[ $# -gt 0 ]]; then
+  apps=("$@")
+else
+  apps=($(find $MEMPOOL_DIR/software/bin -maxdepth 1 -type f ! -name "*.*" | sort))
+fi
+if [[ ${#apps[@]} -eq 0 ]]; then
+  echo "No applications found, build them with 'make -C software/apps'"
+  exit 1
+fi
+
+# Best MIPS of all runs
+mips() {
+  for run in $(seq $runs); do
+    $spike --mempool --mips $SPIKE_FLAGS "$@" 2>&1 >/dev/null | \
+      sed -n 's/.* \([0-9.]*\) MIPS$/\1/p'
+  done | sort -g | tail -n 1
+}
+
+printf "%-24s %12s %12s %8s\n" "Application" "Blocks" "No blocks" "Speedup"
+for app in "${apps[@]}"; do
+  with=$(mips --block-cache "$app")
+  without=$(mips "$app")
+  speedup=$(awk -v a="$with" -v b="$without" 'BEGIN { if (b > 0) printf "%.2f", a / b }')
+  printf "%-24s %12s %12s %8s\n" "$(basename $app)" "$with" "$without" "$speedup"
+done
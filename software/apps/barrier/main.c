@@ -0,0 +1,50 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares the latency of the central and the hierarchical barrier of all
+// cores, i.e., of 16 cores in minpool and 256 cores in mempool.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "encoding.h"
+#include "printf.h"
+#include "runtime.h"
+#include "synchronization.h"
+
+#define REPETITIONS 16
+
+typedef void (*barrier_t)(uint32_t num_cores);
+
+// Average cycles of one barrier, as seen by the calling core
+static uint32_t measure(barrier_t barrier, uint32_t num_cores) {
+  // Warm up the instruction caches
+  barrier(num_cores);
+  mempool_timer_t start = mempool_get_timer();
+  mempool_start_benchmark();
+  for (uint32_t i = 0; i < REPETITIONS; ++i) {
+    barrier(num_cores);
+  }
+  mempool_stop_benchmark();
+  return (mempool_get_timer() - start) / REPETITIONS;
+}
+
+int main() {
+  uint32_t core_id = mempool_get_core_id();
+  uint32_t num_cores = mempool_get_core_count();
+  mempool_barrier_init(core_id);
+
+  uint32_t central = measure(mempool_barrier, num_cores);
+  uint32_t tree = measure(mempool_tree_barrier, num_cores);
+  if (core_id == 0) {
+    printf("%d cores: central barrier %d cycles, tree barrier %d cycles\n",
+           num_cores, central, tree);
+  }
+
+  if (!mempool_stack_check(core_id)) {
+    printf("Stack overflow of core %d, increase stack_size\n", core_id);
+  }
+  mempool_barrier(num_cores);
+  return 0;
+}
@@ -0,0 +1,97 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Measures the locks of the runtime under contention of all cores, i.e., of
+// 16 cores in minpool and 256 cores in mempool, against a test-and-set lock
+// spinning on one word.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "encoding.h"
+#include "lock.h"
+#include "printf.h"
+#include "runtime.h"
+#include "synchronization.h"
+
+#define CRITICAL_SECTIONS 8
+
+uint32_t volatile tas_lock __attribute__((section(".l1")));
+mempool_ticket_lock_t ticket_lock __attribute__((section(".l1")));
+mempool_mcs_lock_t mcs_lock __attribute__((section(".l1")));
+mempool_mutex_t mutex __attribute__((section(".l1")));
+uint32_t volatile counter __attribute__((section(".l1")));
+uint32_t volatile error __attribute__((section(".l1")));
+
+static void tas_acquire(void) {
+  while (__atomic_exchange_n(&tas_lock, 1, __ATOMIC_RELAXED)) {
+  }
+  __sync_synchronize();
+}
+
+static void tas_release(void) {
+  __sync_synchronize();
+  tas_lock = 0;
+}
+
+static void ticket_acquire(void) { mempool_ticket_lock(&ticket_lock); }
+static void ticket_release(void) { mempool_ticket_unlock(&ticket_lock); }
+static void mcs_acquire(void) { mempool_mcs_lock(&mcs_lock); }
+static void mcs_release(void) { mempool_mcs_unlock(&mcs_lock); }
+static void mutex_acquire(void) { mempool_mutex_lock(&mutex); }
+static void mutex_release(void) { mempool_mutex_unlock(&mutex); }
+
+typedef void (*lock_fn_t)(void);
+
+// Cycles of core 0 until all cores went through their critical sections
+static uint32_t run(lock_fn_t acquire, lock_fn_t release, uint32_t core_id,
+                    uint32_t num_cores) {
+  if (core_id == 0) {
+    counter = 0;
+  }
+  mempool_barrier(num_cores);
+  mempool_timer_t start = mempool_get_timer();
+  mempool_start_benchmark();
+  for (uint32_t i = 0; i < CRITICAL_SECTIONS; ++i) {
+    acquire();
+    counter = counter + 1;
+    release();
+  }
+  mempool_stop_benchmark();
+  mempool_barrier(num_cores);
+  uint32_t cycles = mempool_get_timer() - start;
+  if (core_id == 0 && counter != CRITICAL_SECTIONS * num_cores) {
+    error = 1;
+  }
+  return cycles;
+}
+
+int main() {
+  uint32_t core_id = mempool_get_core_id();
+  uint32_t num_cores = mempool_get_core_count();
+  if (core_id == 0) {
+    error = 0;
+    tas_lock = 0;
+    mempool_ticket_lock_init(&ticket_lock);
+    mempool_mcs_lock_init(&mcs_lock);
+    mempool_mutex_init(&mutex);
+  }
+  mempool_barrier_init(core_id);
+
+  const char *names[] = {"test-and-set", "ticket", "mcs", "mutex"};
+  lock_fn_t acquire[] = {tas_acquire, ticket_acquire, mcs_acquire,
+                         mutex_acquire};
+  lock_fn_t release[] = {tas_release, ticket_release, mcs_release,
+                         mutex_release};
+  for (uint32_t l = 0; l < 4; ++l) {
+    uint32_t cycles = run(acquire[l], release[l], core_id, num_cores);
+    if (core_id == 0) {
+      printf("%-12s %d cores: %d cycles per critical section\n", names[l],
+             num_cores, cycles / (CRITICAL_SECTIONS * num_cores));
+    }
+  }
+
+  mempool_barrier(num_cores);
+  return (int)error;
+}
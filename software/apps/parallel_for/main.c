@@ -0,0 +1,95 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+// Compares the static assignment of iterations to cores, i.e., core_id,
+// core_id + num_cores, ..., with mempool_parallel_for() on workloads whose
+// iterations take different times.
+
+#include <stdint.h>
+#include <string.h>
+
+#include "encoding.h"
+#include "parallel.h"
+#include "printf.h"
+#include "runtime.h"
+#include "synchronization.h"
+
+#define ITERATIONS_PER_CORE 8
+
+typedef uint32_t (*workload_t)(int32_t i, uint32_t num_cores);
+
+// Same work for every iteration
+static uint32_t balanced(int32_t i, uint32_t num_cores) {
+  (void)i;
+  (void)num_cores;
+  return 200;
+}
+
+// Like the rows of a triangular matrix, the work grows with the iteration
+static uint32_t triangular(int32_t i, uint32_t num_cores) {
+  return 400 * (uint32_t)i / (ITERATIONS_PER_CORE * num_cores);
+}
+
+// Like sparse data, a few iterations of a pseudo-random pattern are heavy
+static uint32_t sparse(int32_t i, uint32_t num_cores) {
+  (void)num_cores;
+  uint32_t hash = (uint32_t)i * 2654435761u;
+  return (hash >> 29) == 0 ? 1500 : 20;
+}
+
+// Like the borders of an image, the first and the last iterations are heavy
+static uint32_t border(int32_t i, uint32_t num_cores) {
+  int32_t n = ITERATIONS_PER_CORE * (int32_t)num_cores;
+  return i < n / 8 || i >= n - n / 8 ? 800 : 50;
+}
+
+typedef struct {
+  workload_t workload;
+  uint32_t num_cores;
+} work_t;
+
+static void body(int32_t i, void *arg) {
+  work_t *work = arg;
+  mempool_wait(work->workload(i, work->num_cores));
+}
+
+// Cycles of core 0 from the first barrier to the last
+static uint32_t run(workload_t workload, uint32_t core_id, uint32_t num_cores,
+                    uint32_t dynamic) {
+  int32_t n = ITERATIONS_PER_CORE * (int32_t)num_cores;
+  work_t work = {workload, num_cores};
+  mempool_barrier(num_cores);
+  mempool_timer_t start = mempool_get_timer();
+  mempool_start_benchmark();
+  if (dynamic) {
+    mempool_parallel_for(0, n, 1, body, &work, num_cores);
+  } else {
+    for (int32_t i = (int32_t)core_id; i < n; i += (int32_t)num_cores) {
+      body(i, &work);
+    }
+    mempool_barrier(num_cores);
+  }
+  mempool_stop_benchmark();
+  return mempool_get_timer() - start;
+}
+
+int main() {
+  uint32_t core_id = mempool_get_core_id();
+  uint32_t num_cores = mempool_get_core_count();
+  mempool_barrier_init(core_id);
+
+  const char *names[] = {"balanced", "triangular", "sparse", "border"};
+  workload_t workloads[] = {balanced, triangular, sparse, border};
+  for (uint32_t w = 0; w < 4; ++w) {
+    uint32_t static_cycles = run(workloads[w], core_id, num_cores, 0);
+    uint32_t dynamic_cycles = run(workloads[w], core_id, num_cores, 1);
+    if (core_id == 0) {
+      printf("%-10s static %6d cycles, dynamic %6d cycles\n", names[w],
+             static_cycles, dynamic_cycles);
+    }
+  }
+
+  mempool_barrier(num_cores);
+  return 0;
+}
@@ -7,6 +7,7 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "encoding.h"
 #include "kernel/mat_mul.h"
 #include "printf.h"
@@ -116,6 +117,40 @@ int test_matrix_multiplication(int32_t *__restrict__ A, int32_t *__restrict__ B,
   return 0;
 }
 
+// Every core allocates a word from the pool of its tile, then the first core
+// of the tile allocates the whole pool
+int test_tile_pool(uint32_t core_id, uint32_t num_cores) {
+  uint32_t tile_id = mempool_get_tile_id(core_id);
+  uint32_t tile_start = tile_id * SEQ_MEM_SIZE;
+  uint32_t tile_end = tile_start + SEQ_MEM_SIZE;
+  void *mark = mempool_tile_mark(tile_id);
+  // Wait until all cores have their mark
+  mempool_barrier(num_cores);
+  uint32_t volatile *word = mempool_tile_alloc(tile_id, sizeof(uint32_t));
+  if (word == NULL || (uint32_t)word < tile_start ||
+      (uint32_t)word >= tile_end) {
+    error = 1;
+  } else {
+    *word = core_id;
+  }
+  mempool_barrier(num_cores);
+  if (word != NULL && *word != core_id) {
+    error = 1;
+  }
+  // Wait at barrier before freeing the words
+  mempool_barrier(num_cores);
+  if (core_id % NUM_CORES_PER_TILE == 0) {
+    mempool_tile_reset(tile_id, mark);
+    uint8_t *pool = mempool_tile_alloc(tile_id, L1_SEQ_POOL_SIZE);
+    if (pool == NULL || (uint32_t)(pool + L1_SEQ_POOL_SIZE) > tile_end) {
+      error = 1;
+    }
+    mempool_tile_reset(tile_id, mark);
+  }
+  mempool_barrier(num_cores);
+  return error;
+}
+
 int main() {
   uint32_t core_id = mempool_get_core_id();
   uint32_t num_cores = mempool_get_core_count();
@@ -129,6 +164,8 @@ int main() {
   // Test the Matrix multiplication
   test_matrix_multiplication(matrix_a, matrix_b, matrix_c, matrix_M, matrix_N,
                              matrix_P, core_id, num_cores);
+  // Test the pools in the sequential memory of the tiles
+  test_tile_pool(core_id, num_cores);
   // wait until all cores have finished
   mempool_barrier(num_cores);
 
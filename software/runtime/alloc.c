@@ -0,0 +1,174 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "alloc.h"
+#include "lock.h"
+#include "runtime.h"
+
+// Free memory after the sections of the interleaved L1 and of the .l1_seq
+// section in every tile, see link.ld
+extern char __l1_alloc_base;
+extern char __l1_end;
+extern char __l1_seq_alloc_base;
+extern char __l1_seq_end;
+
+// The arena allocates from top to end. The top address takes the lower
+// ARENA_TOP_BITS of the top word and a version the upper ones, which
+// mempool_l1_reserve() increments after it lowered the end. An allocation
+// that read the end before then fails its compare-and-swap of the top and
+// reads the end again.
+#define ARENA_TOP_BITS 21
+#define ARENA_TOP_MASK ((1u << ARENA_TOP_BITS) - 1)
+#define ARENA_VERSION (1u << ARENA_TOP_BITS)
+_Static_assert(NUM_CORES * 0x1000 < ARENA_VERSION,
+               "The L1 does not fit into the top address of an arena");
+
+typedef struct {
+  uint32_t volatile top;
+  uint32_t volatile end;
+} arena_t;
+
+arena_t l1_arena __attribute__((section(".l1")));
+
+// Reservations of the end of the arena that were not given back yet
+uint32_t l1_reservations __attribute__((section(".l1")));
+mempool_ticket_lock_t l1_reservation_lock __attribute__((section(".l1")));
+
+// Pool of every tile, in the banks of the tile
+MEMPOOL_TILE_LOCAL(arena_t, tile_pool);
+
+// Whether core 0 initialized the arena and the pools. The flag is in L2,
+// which is zero when the binary is loaded, unlike the NOLOAD sections in L1.
+// Only core 0 writes it, as L2 does not support atomics.
+static uint32_t volatile alloc_ready __attribute__((section(".data")));
+
+static inline size_t align_size(size_t size) {
+  return (size + MEMPOOL_ALLOC_ALIGN - 1) & ~(size_t)(MEMPOOL_ALLOC_ALIGN - 1);
+}
+
+static void *arena_alloc(arena_t *arena, size_t size) {
+  uint32_t bytes = (uint32_t)align_size(size);
+  if (bytes < size) {
+    return NULL;
+  }
+  // Only move the top if the allocation fits, so that a failed allocation
+  // never hands out memory of another one
+  uint32_t top = arena->top;
+  uint32_t addr;
+  do {
+    // Read the end after the top, so that it is at least as new as the version
+    __sync_synchronize();
+    uint32_t end = arena->end;
+    addr = top & ARENA_TOP_MASK;
+    if (addr > end || bytes > end - addr) {
+      return NULL;
+    }
+  } while (!__atomic_compare_exchange_n(&arena->top, &top, top + bytes, false,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+  return (void *)addr;
+}
+
+static inline void *arena_mark(arena_t *arena) {
+  return (void *)(arena->top & ARENA_TOP_MASK);
+}
+
+static inline void arena_reset(arena_t *arena, void *mark) {
+  uint32_t version = (arena->top & ~ARENA_TOP_MASK) + ARENA_VERSION;
+  arena->top = version | (uint32_t)mark;
+}
+
+void mempool_alloc_init(void) {
+  l1_arena.top = (uint32_t)&__l1_alloc_base;
+  l1_arena.end = (uint32_t)&__l1_end;
+  l1_reservations = 0;
+  mempool_ticket_lock_init(&l1_reservation_lock);
+  for (uint32_t t = 0; t < NUM_TILES; ++t) {
+    arena_t *pool = &tile_pool[t].value;
+    pool->top = (uint32_t)mempool_tile_local(&__l1_seq_alloc_base, t);
+    pool->end = (uint32_t)mempool_tile_local(&__l1_seq_end, t);
+  }
+  __sync_synchronize();
+  alloc_ready = 1;
+}
+
+// Waits for core 0 to initialize the arena and the pools, which it does before
+// main(), so the other cores can only catch up with it right after the boot
+static inline void alloc_wait_ready(void) {
+  if (alloc_ready) {
+    return;
+  }
+  while (!alloc_ready) {
+  }
+  __sync_synchronize();
+}
+
+void *mempool_l1_alloc(size_t size) {
+  alloc_wait_ready();
+  return arena_alloc(&l1_arena, size);
+}
+
+void *mempool_l1_mark(void) {
+  alloc_wait_ready();
+  return arena_mark(&l1_arena);
+}
+
+void mempool_l1_reset(void *mark) { arena_reset(&l1_arena, mark); }
+
+bool mempool_l1_reserve(void *start) {
+  alloc_wait_ready();
+  uint32_t end = (uint32_t)start;
+  if (end > (uint32_t)&__l1_end || end < (uint32_t)arena_mark(&l1_arena)) {
+    return false;
+  }
+  // The lock orders the reservations, so only they write the end
+  mempool_ticket_lock(&l1_reservation_lock);
+  uint32_t old = l1_arena.end;
+  if (end < old) {
+    l1_arena.end = end;
+  }
+  __sync_synchronize();
+  // Bump the version, so that every allocation from now on sees the new end.
+  // The ones before ended at the top that the version is bumped on.
+  uint32_t top = l1_arena.top;
+  while (!__atomic_compare_exchange_n(&l1_arena.top, &top, top + ARENA_VERSION,
+                                      false, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+  }
+  bool reserved = (top & ARENA_TOP_MASK) <= end;
+  if (reserved) {
+    l1_reservations = l1_reservations + 1;
+  } else {
+    // Put back the end of the live reservations
+    l1_arena.end = old;
+  }
+  mempool_ticket_unlock(&l1_reservation_lock);
+  return reserved;
+}
+
+void mempool_l1_release(void) {
+  mempool_ticket_lock(&l1_reservation_lock);
+  l1_reservations = l1_reservations - 1;
+  if (l1_reservations == 0) {
+    l1_arena.end = (uint32_t)&__l1_end;
+  }
+  mempool_ticket_unlock(&l1_reservation_lock);
+}
+
+void *mempool_tile_alloc(uint32_t tile_id, size_t size) {
+  alloc_wait_ready();
+  return arena_alloc(&tile_pool[tile_id].value, size);
+}
+
+void *mempool_tile_mark(uint32_t tile_id) {
+  alloc_wait_ready();
+  return arena_mark(&tile_pool[tile_id].value);
+}
+
+void mempool_tile_reset(uint32_t tile_id, void *mark) {
+  arena_reset(&tile_pool[tile_id].value, mark);
+}
@@ -0,0 +1,59 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __ALLOC_H__
+#define __ALLOC_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// L1 allocator with an arena in the interleaved L1 and a pool in the
+// sequential memory of every tile. Both allocate by bumping a pointer with one
+// atomic, so they are safe to call from all cores at once. Memory is freed by
+// resetting an arena or pool to an earlier mark, which the caller must not do
+// while other cores still allocate from it, e.g., only between barriers.
+//
+// The pool of a tile is the free sequential memory between the tile's copy of
+// the .l1_seq section and the stacks of its cores, at least L1_SEQ_POOL_SIZE
+// bytes, which is l1_seq_pool_size in config/config.mk.
+
+// Alignment of all allocations
+#define MEMPOOL_ALLOC_ALIGN 16
+
+// Initializes the arena and the pools. Called by core 0 in crt0.S before
+// main(), the other cores wait for it on their first allocation.
+void mempool_alloc_init(void);
+
+/// Allocate size bytes of the interleaved L1. Returns NULL if the arena is
+/// exhausted.
+void *mempool_l1_alloc(size_t size);
+
+/// Mark of the current top of the arena.
+void *mempool_l1_mark(void);
+
+/// Free all allocations of the arena made after the mark was taken.
+void mempool_l1_reset(void *mark);
+
+/// Reserve the end of the arena from the given address on, e.g., for buffers
+/// that every core places at the same address without communicating. Returns
+/// false if the arena already reaches beyond the address. Resetting the arena
+/// to a mark does not give the reservation back, but mempool_l1_release().
+bool mempool_l1_reserve(void *start);
+
+/// Give back a successful reservation. Once all of them are given back, the
+/// arena reaches up to the end of the L1 again.
+void mempool_l1_release(void);
+
+/// Allocate size bytes in the sequential memory of the given tile, i.e., in
+/// the tile's local banks. Returns NULL if the pool is exhausted.
+void *mempool_tile_alloc(uint32_t tile_id, size_t size);
+
+/// Mark of the current top of the tile's pool.
+void *mempool_tile_mark(uint32_t tile_id);
+
+/// Free all allocations of the tile's pool made after the mark was taken.
+void mempool_tile_reset(uint32_t tile_id, void *mark);
+
+#endif // __ALLOC_H__
@@ -19,9 +19,20 @@ SECTIONS {
   __rom_start = ORIGIN(rom);
   __rom_end = ORIGIN(rom) + LENGTH(rom);
 
-  // Stack size
-  __stack_start = __l1_start;
-  __stack_end = __l1_start + (NUM_CORES * 0x400);
+  // Sequential region, the first SEQ_MEM_SIZE bytes of every tile. Each tile
+  // holds its copy of the .l1_seq section, followed by its pool of at least
+  // L1_SEQ_POOL_SIZE bytes up to __l1_seq_end and the stacks of its cores at
+  // the top. The bottom word of every stack is its canary, the one of the last
+  // core of tile 0 is at __stack_canary.
+  __seq_start = __l1_start;
+  __seq_end = __l1_start + (NUM_CORES / NUM_CORES_PER_TILE) * SEQ_MEM_SIZE;
+  __stack_canary = __l1_start + SEQ_MEM_SIZE - NUM_CORES_PER_TILE * STACK_SIZE;
+  __l1_seq_end = __stack_canary;
+  __l1_seq_pool_size = L1_SEQ_POOL_SIZE;
+
+  // Row of the interleaved region, whose slices of NUM_CORES_PER_TILE * 16
+  // bytes map to the banks of the tiles in turn, see MEMPOOL_TILE_LOCAL
+  __l1_row_size = NUM_CORES * 16;
 
   // Hardware register location
   eoc_reg                = 0x40000000;
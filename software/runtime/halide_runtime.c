@@ -5,6 +5,8 @@
 // Author: Samuel Riedel, ETH Zurich
 
 #include "halide_runtime.h"
+#include "alloc.h"
+#include "parallel.h"
 #include "printf.h"
 #include "runtime.h"
 #include "synchronization.h"
@@ -16,9 +18,53 @@
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wunused-parameter"
 
-void *halide_malloc(void *user_context, size_t x) { return (void *)0x0000b000; }
+// All cores run the pipeline and make the same allocations outside of the
+// parallel loops. Every core therefore stacks them down from the end of the L1
+// arena on its own and gets the same addresses without communicating. Every
+// buffer reserves its memory in the arena, and halide_free() gives the
+// reservation back, so the arena reaches up to the end of the L1 again once
+// all cores freed their buffers. The stack of a core is emptied once all of
+// its buffers are freed. Each core's state is in L2, which is zero when the
+// binary is loaded.
+typedef struct {
+  uint32_t size;    // Bytes of the stacked buffers
+  uint32_t live;    // Buffers not yet freed
+  uint32_t in_task; // Whether the core runs a task of halide_do_par_for
+  uint32_t loops;   // Parallel loops that the core ran
+} halide_heap_t;
+
+static halide_heap_t halide_heap[NUM_CORES] __attribute__((section(".data")));
+
+extern char __l1_end;
+
+void *halide_malloc(void *user_context, size_t x) {
+  halide_heap_t *heap = &halide_heap[mempool_get_core_id()];
+  if (heap->in_task) {
+    // Each core would need its own buffer, but the cores place them alike
+    halide_error(user_context, "halide_malloc in a parallel task");
+    return NULL;
+  }
+  size_t size = heap->size + ((x + MEMPOOL_ALLOC_ALIGN - 1) &
+                              ~(size_t)(MEMPOOL_ALLOC_ALIGN - 1));
+  char *ptr = &__l1_end - size;
+  if (size < heap->size || !mempool_l1_reserve(ptr)) {
+    return NULL;
+  }
+  heap->size = size;
+  heap->live++;
+  return ptr;
+}
 
-void halide_free(void *user_context, void *ptr) {}
+void halide_free(void *user_context, void *ptr) {
+  halide_heap_t *heap = &halide_heap[mempool_get_core_id()];
+  if (ptr == NULL) {
+    return;
+  }
+  mempool_l1_release();
+  if (--heap->live == 0) {
+    heap->size = 0;
+  }
+}
 
 char *getenv(const char *name) { return NULL; };
 
@@ -67,15 +113,61 @@ void halide_print(void *user_context, const char *msg) { printf("%s\n", msg); }
 // Parallel //
 //////////////
 
-// Halide calls this function
+typedef struct {
+  void *user_context;
+  halide_task_t task;
+  uint8_t *closure;
+  int volatile *error;
+} halide_par_for_t;
+
+// First error of the tasks of a parallel loop on any core, in L1 for the
+// atomics. The loops take turns with the words. Core 0 clears the word of a
+// loop before the loop's first barrier, which every core passes only after it
+// read the error of the loop before the previous one.
+#define HALIDE_PAR_FOR_ERRORS 2
+static int volatile halide_par_for_error[HALIDE_PAR_FOR_ERRORS]
+    __attribute__((section(".l1")));
+
+static void halide_par_for_body(int32_t i, void *arg) {
+  halide_par_for_t *par_for = arg;
+  int error = par_for->task(par_for->user_context, i, par_for->closure);
+  if (error != 0 && *par_for->error == 0) {
+    int expected = 0;
+    __atomic_compare_exchange_n(par_for->error, &expected, error, false,
+                                __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+  }
+}
+
+// Halide calls this function on all cores, which share the tasks dynamically.
+// It returns on every core once all tasks are done, with the first error of
+// the tasks on any core.
 int halide_do_par_for(void *user_context, halide_task_t task, int min, int size,
                       uint8_t *closure) {
-  for (uint32_t core_id = mempool_get_core_id(); core_id < (uint32_t)size;
-       core_id += mempool_get_core_count()) {
-    task(user_context, (int32_t)core_id, closure);
+  uint32_t core_id = mempool_get_core_id();
+  halide_heap_t *heap = &halide_heap[core_id];
+  if (heap->in_task) {
+    // A nested loop runs on the core of the outer task alone
+    int volatile error = 0;
+    halide_par_for_t par_for = {user_context, task, closure, &error};
+    for (int i = min; i < min + size; ++i) {
+      halide_par_for_body(i, &par_for);
+    }
+    return error;
   }
-
-  return 0;
+  int volatile *error =
+      &halide_par_for_error[heap->loops++ % HALIDE_PAR_FOR_ERRORS];
+  if (core_id == 0) {
+    *error = 0;
+  }
+  halide_par_for_t par_for = {user_context, task, closure, error};
+  heap->in_task = 1;
+  // The barriers at the start and the end of the loop order the clearing, the
+  // errors of the tasks, and the reads of the error
+  mempool_parallel_for(min, min + size, 1, halide_par_for_body, &par_for,
+                       mempool_get_core_count());
+  heap->in_task = 0;
+
+  return *error;
 }
 
 #pragma GCC diagnostic pop
@@ -0,0 +1,104 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lock.h"
+#include "runtime.h"
+
+// Cycles a core waits per core ahead of it before it checks its ticket again
+#define TICKET_BACKOFF 16
+
+void mempool_ticket_lock_init(mempool_ticket_lock_t *lock) {
+  lock->next = 0;
+  lock->serving = 0;
+}
+
+void mempool_ticket_lock(mempool_ticket_lock_t *lock) {
+  uint32_t ticket = __atomic_fetch_add(&lock->next, 1, __ATOMIC_RELAXED);
+  uint32_t serving;
+  while ((serving = lock->serving) != ticket) {
+    mempool_wait((ticket - serving) * TICKET_BACKOFF);
+  }
+  __sync_synchronize();
+}
+
+void mempool_ticket_unlock(mempool_ticket_lock_t *lock) {
+  __sync_synchronize();
+  lock->serving = lock->serving + 1;
+}
+
+// Queue node of every core, in the sequential memory of its tile
+typedef struct {
+  uint32_t volatile next;   // Successor plus one, or zero
+  uint32_t volatile locked; // Whether the core still waits for the lock
+} mcs_node_t;
+
+mcs_node_t mcs_nodes[NUM_CORES_PER_TILE] __attribute__((section(".l1_seq")));
+
+static inline mcs_node_t *mcs_node(uint32_t core_id) {
+  return mempool_tile_local(&mcs_nodes[core_id % NUM_CORES_PER_TILE],
+                            mempool_get_tile_id(core_id));
+}
+
+static void mcs_lock(mempool_mcs_lock_t *lock, bool sleep) {
+  uint32_t core_id = mempool_get_core_id();
+  mcs_node_t *node = mcs_node(core_id);
+  node->next = 0;
+  node->locked = 1;
+  __sync_synchronize();
+  uint32_t pred = __atomic_exchange_n(&lock->tail, core_id + 1,
+                                      __ATOMIC_RELAXED);
+  if (pred != 0) {
+    // Queue up behind the predecessor and wait for the hand-over
+    mcs_node(pred - 1)->next = core_id + 1;
+    if (sleep) {
+      // Every hand-over wakes up the core once, which the WFI consumes even if
+      // the lock was handed over before
+      do {
+        mempool_wfi();
+      } while (node->locked);
+    } else {
+      while (node->locked) {
+      }
+    }
+  }
+  __sync_synchronize();
+}
+
+static void mcs_unlock(mempool_mcs_lock_t *lock, bool sleep) {
+  uint32_t core_id = mempool_get_core_id();
+  mcs_node_t *node = mcs_node(core_id);
+  __sync_synchronize();
+  if (node->next == 0) {
+    // Release the lock if nobody queued up
+    uint32_t expected = core_id + 1;
+    if (__atomic_compare_exchange_n(&lock->tail, &expected, 0, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      return;
+    }
+    // A successor swapped the tail and is about to link itself
+    while (node->next == 0) {
+    }
+  }
+  uint32_t succ = node->next - 1;
+  mcs_node(succ)->locked = 0;
+  if (sleep) {
+    __sync_synchronize(); // Full memory barrier
+    wake_up(succ);
+  }
+}
+
+void mempool_mcs_lock_init(mempool_mcs_lock_t *lock) { lock->tail = 0; }
+
+void mempool_mcs_lock(mempool_mcs_lock_t *lock) { mcs_lock(lock, false); }
+
+void mempool_mcs_unlock(mempool_mcs_lock_t *lock) { mcs_unlock(lock, false); }
+
+void mempool_mutex_init(mempool_mutex_t *mutex) { mutex->tail = 0; }
+
+void mempool_mutex_lock(mempool_mutex_t *mutex) { mcs_lock(mutex, true); }
+
+void mempool_mutex_unlock(mempool_mutex_t *mutex) { mcs_unlock(mutex, true); }
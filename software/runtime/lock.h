@@ -0,0 +1,46 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __LOCK_H__
+#define __LOCK_H__
+
+#include <stdint.h>
+
+// Locks for mutual exclusion between cores. The lock variables are best
+// placed in the interleaved L1, e.g., with __attribute__((section(".l1"))),
+// and must be initialized before the first core uses them.
+
+// Ticket lock. The cores draw a ticket with one atomic and spin until it is
+// served, backing off in proportion to the number of cores ahead of them.
+typedef struct {
+  uint32_t volatile next;
+  uint32_t volatile serving;
+} mempool_ticket_lock_t;
+
+void mempool_ticket_lock_init(mempool_ticket_lock_t *lock);
+void mempool_ticket_lock(mempool_ticket_lock_t *lock);
+void mempool_ticket_unlock(mempool_ticket_lock_t *lock);
+
+// MCS queue lock. The waiting cores queue up with one swap on the lock and
+// then wait on a node in their tile's sequential memory, until their
+// predecessor hands the lock over. Every core has one node, so a core can
+// only hold or wait for one MCS lock or mutex at a time.
+typedef struct {
+  uint32_t volatile tail; // Last core in the queue plus one, or zero
+} mempool_mcs_lock_t;
+
+void mempool_mcs_lock_init(mempool_mcs_lock_t *lock);
+// The waiting cores spin on their node
+void mempool_mcs_lock(mempool_mcs_lock_t *lock);
+void mempool_mcs_unlock(mempool_mcs_lock_t *lock);
+
+// Mutex, an MCS lock whose waiting cores sleep in WFI until their predecessor
+// wakes them up with wake_up(core_id)
+typedef mempool_mcs_lock_t mempool_mutex_t;
+
+void mempool_mutex_init(mempool_mutex_t *mutex);
+void mempool_mutex_lock(mempool_mutex_t *mutex);
+void mempool_mutex_unlock(mempool_mutex_t *mutex);
+
+#endif // __LOCK_H__
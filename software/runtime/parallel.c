@@ -0,0 +1,81 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdint.h>
+
+#include "parallel.h"
+#include "runtime.h"
+#include "synchronization.h"
+
+// Next iteration of the part of every core, in the banks of its tile
+typedef int32_t volatile parallel_tile_next_t[NUM_CORES_PER_TILE];
+MEMPOOL_TILE_LOCAL(parallel_tile_next_t, parallel_next);
+
+static inline int32_t volatile *parallel_counter(uint32_t core_id) {
+  return &parallel_next[mempool_get_tile_id(core_id)]
+              .value[core_id % NUM_CORES_PER_TILE];
+}
+
+// First iteration of the part of a core, the remainder goes to the first cores
+static inline int32_t parallel_part(int32_t begin, uint32_t iterations,
+                                    uint32_t core_id, uint32_t num_cores) {
+  uint32_t size = iterations / num_cores;
+  uint32_t rest = iterations % num_cores;
+  return begin + (int32_t)(core_id * size + (core_id < rest ? core_id : rest));
+}
+
+// Runs the chunks of the given core's part until none are left
+static void parallel_run(int32_t begin, int32_t end, uint32_t chunk,
+                         mempool_parallel_body_t body, void *arg,
+                         uint32_t owner, uint32_t num_cores) {
+  int32_t volatile *counter = parallel_counter(owner);
+  int32_t part_end =
+      parallel_part(begin, (uint32_t)(end - begin), owner + 1, num_cores);
+  // Skip exhausted parts without an atomic
+  while (*counter < part_end) {
+    int32_t i = __atomic_fetch_add(counter, (int32_t)chunk, __ATOMIC_RELAXED);
+    if (i >= part_end) {
+      return;
+    }
+    int32_t chunk_end = part_end - i > (int32_t)chunk ? i + (int32_t)chunk
+                                                      : part_end;
+    for (; i < chunk_end; ++i) {
+      body(i, arg);
+    }
+  }
+}
+
+void mempool_parallel_for(int32_t begin, int32_t end, uint32_t chunk,
+                          mempool_parallel_body_t body, void *arg,
+                          uint32_t num_cores) {
+  uint32_t core_id = mempool_get_core_id();
+  if (chunk == 0) {
+    chunk = 1;
+  }
+  if (end < begin) {
+    end = begin;
+  }
+
+  // Nobody may steal before all parts are set up
+  *parallel_counter(core_id) =
+      parallel_part(begin, (uint32_t)(end - begin), core_id, num_cores);
+  mempool_tree_barrier(num_cores);
+
+  // Run the own part, then steal from the other cores of the tile, and then
+  // from the following tiles
+  uint32_t tile_id = mempool_get_tile_id(core_id);
+  uint32_t num_tiles = (num_cores + NUM_CORES_PER_TILE - 1) / NUM_CORES_PER_TILE;
+  for (uint32_t t = 0; t < num_tiles; ++t) {
+    uint32_t victim_tile = (tile_id + t) % num_tiles;
+    for (uint32_t c = 0; c < NUM_CORES_PER_TILE; ++c) {
+      uint32_t victim = victim_tile * NUM_CORES_PER_TILE +
+                        (core_id + c) % NUM_CORES_PER_TILE;
+      if (victim < num_cores) {
+        parallel_run(begin, end, chunk, body, arg, victim, num_cores);
+      }
+    }
+  }
+
+  mempool_tree_barrier(num_cores);
+}
@@ -0,0 +1,26 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <stdint.h>
+
+typedef void (*mempool_parallel_body_t)(int32_t i, void *arg);
+
+// Runs body(i, arg) for every i from begin to end-1 on the cores 0 to
+// num_cores-1, which all call it with the same bounds and chunk size. The
+// arg of the calling core is passed to the bodies it runs.
+//
+// Every core owns a contiguous part of the iterations and claims chunks of it
+// from a counter in the banks of its tile, so the claims of
+// different cores go to different banks. A core that finished its part
+// steals chunks from the others, starting with its neighbors in the tile.
+// The cores synchronize with mempool_tree_barrier() before they start and
+// once all iterations are done.
+void mempool_parallel_for(int32_t begin, int32_t end, uint32_t chunk,
+                          mempool_parallel_body_t body, void *arg,
+                          uint32_t num_cores);
+
+#endif // __PARALLEL_H__
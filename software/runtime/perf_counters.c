@@ -0,0 +1,30 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#include <stdint.h>
+
+#include "perf_counters.h"
+#include "printf.h"
+
+void mempool_perf_diff(mempool_perf_t *diff, const mempool_perf_t *start,
+                       const mempool_perf_t *end) {
+  const uint32_t *s = (const uint32_t *)start;
+  const uint32_t *e = (const uint32_t *)end;
+  uint32_t *d = (uint32_t *)diff;
+  for (uint32_t i = 0; i < sizeof(mempool_perf_t) / sizeof(uint32_t); ++i) {
+    d[i] = e[i] - s[i];
+  }
+}
+
+void mempool_perf_print(uint32_t core_id, const mempool_perf_t *start,
+                        const mempool_perf_t *end) {
+  mempool_perf_t d;
+  mempool_perf_diff(&d, start, end);
+  printf("[core %3d] cycles %d instret %d wfi %d stall_load %d\n", core_id,
+         d.cycles, d.instret, d.wfi, d.stall_load);
+  printf("[core %3d] icache L0 %d/%d L1 %d/%d (hit/miss)\n", core_id, d.l0_hit,
+         d.l0_miss, d.l1_hit, d.l1_miss);
+  printf("[core %3d] tcdm local %d remote %d amo %d\n", core_id, d.tcdm_local,
+         d.tcdm_remote, d.amo);
+}
@@ -0,0 +1,55 @@
+// Copyright 2021 ETH Zurich and University of Bologna.
+// Licensed under the Apache License, Version 2.0, see LICENSE for details.
+// SPDX-License-Identifier: Apache-2.0
+
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <stdint.h>
+
+#include "encoding.h"
+
+// Per-core performance counters. The counters are 32 bits wide and wrap
+// around, so only the difference of two snapshots is meaningful. Spike reads
+// the event counters as zero.
+typedef struct {
+  uint32_t cycles;      // mcycle
+  uint32_t instret;     // minstret
+  uint32_t l0_hit;      // mhpmcounter3: L0 instruction cache hits
+  uint32_t l0_miss;     // mhpmcounter4: L0 instruction cache misses
+  uint32_t l1_hit;      // mhpmcounter5: L1 instruction cache hits
+  uint32_t l1_miss;     // mhpmcounter6: L1 instruction cache misses
+  uint32_t stall_load;  // mhpmcounter7: cycles stalled on the LSU or a load
+  uint32_t tcdm_local;  // mhpmcounter8: requests to the own tile's banks
+  uint32_t tcdm_remote; // mhpmcounter9: requests to other tiles' banks
+  uint32_t amo;         // mhpmcounter10: atomic memory operations
+  uint32_t wfi;         // mhpmcounter11: cycles asleep in WFI
+} mempool_perf_t;
+
+/// Read all performance counters of the current core.
+static inline void mempool_perf_snapshot(mempool_perf_t *perf) {
+  asm volatile("" ::: "memory");
+  perf->cycles = read_csr(mcycle);
+  perf->instret = read_csr(minstret);
+  perf->l0_hit = read_csr(mhpmcounter3);
+  perf->l0_miss = read_csr(mhpmcounter4);
+  perf->l1_hit = read_csr(mhpmcounter5);
+  perf->l1_miss = read_csr(mhpmcounter6);
+  perf->stall_load = read_csr(mhpmcounter7);
+  perf->tcdm_local = read_csr(mhpmcounter8);
+  perf->tcdm_remote = read_csr(mhpmcounter9);
+  perf->amo = read_csr(mhpmcounter10);
+  perf->wfi = read_csr(mhpmcounter11);
+  asm volatile("" ::: "memory");
+}
+
+/// Compute the events between two snapshots of the same core.
+void mempool_perf_diff(mempool_perf_t *diff, const mempool_perf_t *start,
+                       const mempool_perf_t *end);
+
+/// Print the events between two snapshots of the given core, e.g., taken
+/// around mempool_start_benchmark() and mempool_stop_benchmark().
+void mempool_perf_print(uint32_t core_id, const mempool_perf_t *start,
+                        const mempool_perf_t *end);
+
+#endif // __PERF_COUNTERS_H__
@@ -17,6 +17,15 @@ extern uint32_t wake_up_reg;
 typedef uint32_t mempool_id_t;
 typedef uint32_t mempool_timer_t;
 
+// Organization of the cores, like in hardware/src/mempool_pkg.sv. runtime.mk
+// passes NUM_GROUPS from the configuration.
+#ifndef NUM_GROUPS
+#define NUM_GROUPS 4
+#endif
+#define NUM_TILES (NUM_CORES / NUM_CORES_PER_TILE)
+#define NUM_TILES_PER_GROUP (NUM_TILES / NUM_GROUPS)
+#define NUM_CORES_PER_GROUP (NUM_CORES / NUM_GROUPS)
+
 /// Obtain the number of cores in the current cluster.
 static inline mempool_id_t mempool_get_core_count() {
   extern uint32_t nr_cores_address_reg;
@@ -30,6 +39,41 @@ static inline mempool_id_t mempool_get_core_id() {
   return r;
 }
 
+/// Obtain the tile of the given core.
+static inline mempool_id_t mempool_get_tile_id(mempool_id_t core_id) {
+  return core_id / NUM_CORES_PER_TILE;
+}
+
+/// Obtain the group of the given core.
+static inline mempool_id_t mempool_get_group_id(mempool_id_t core_id) {
+  return core_id / NUM_CORES_PER_GROUP;
+}
+
+/// Bytes of every row of the interleaved L1 in the banks of one tile, i.e., its
+/// NUM_CORES_PER_TILE * 4 banks of 4 B.
+#define L1_TILE_SLICE (NUM_CORES_PER_TILE * 4 * 4)
+
+/// Declare a tile-local variable `name[tile]` in the interleaved L1. The copy
+/// of every tile fills the tile's slice of a row, so each tile accesses its own
+/// copy in its local banks without using the sequential memory of the stacks.
+/// The type must fit in L1_TILE_SLICE, and arrays of tile-local variables are
+/// declared as `MEMPOOL_TILE_LOCAL(type, name[n])`, i.e., `name[i][tile]`.
+#define MEMPOOL_TILE_LOCAL(type, name)                                         \
+  _Static_assert(sizeof(type) <= L1_TILE_SLICE,                                \
+                 "Tile-local " #type " exceeds the slice of a tile");          \
+  union {                                                                      \
+    type value;                                                                \
+    char slice[L1_TILE_SLICE];                                                 \
+  } name[NUM_TILES]                                                            \
+      __attribute__((section(".l1_tile"), aligned(L1_TILE_SLICE)))
+
+/// Obtain the copy of a `.l1_seq` variable in the given tile. The section is
+/// replicated in the sequential memory of every tile, so each tile accesses its
+/// own copy in its local banks.
+static inline void *mempool_tile_local(void *ptr, mempool_id_t tile_id) {
+  return (char *)ptr + tile_id * SEQ_MEM_SIZE;
+}
+
 /// Reset a monotonically increasing cycle count.
 static inline void mempool_start_benchmark() {
   asm volatile("" ::: "memory");
@@ -60,7 +60,10 @@ RISCV_STRIP   ?= $(RISCV_PREFIX)strip
 
 # Defines
 DEFINES += -DPRINTF_DISABLE_SUPPORT_FLOAT -DPRINTF_DISABLE_SUPPORT_LONG_LONG -DPRINTF_DISABLE_SUPPORT_PTRDIFF_T
-DEFINES += -DNUM_CORES=$(num_cores) -DBOOT_ADDR=0x$(boot_addr) -DL2_BASE=0x$(l2_base) -DL2_SIZE=0x$(l2_size)
+# Sequential memory of every tile, like SeqMemSizePerTile in mempool_pkg.sv
+seq_mem_size := $(shell echo $$(( 1024 * $(num_cores_per_tile) )))
+DEFINES += -DNUM_CORES=$(num_cores) -DNUM_GROUPS=$(num_groups) -DNUM_CORES_PER_TILE=$(num_cores_per_tile) -DSEQ_MEM_SIZE=$(seq_mem_size) -DSTACK_SIZE=$(stack_size) -DL1_SEQ_POOL_SIZE=$(l1_seq_pool_size)
+DEFINES += -DBOOT_ADDR=0x$(boot_addr) -DL2_BASE=0x$(l2_base) -DL2_SIZE=0x$(l2_size)
 
 # Specify cross compilation target. This can be omitted if LLVM is built with riscv as default target
 RISCV_LLVM_TARGET  ?= --target=$(RISCV_TARGET) --sysroot=$(GCC_INSTALL_DIR)/$(RISCV_TARGET) --gcc-toolchain=$(GCC_INSTALL_DIR)
@@ -84,7 +87,7 @@ else
 endif
 
 LINKER_SCRIPT ?= $(ROOT_DIR)/arch.ld
-RUNTIME ?= $(ROOT_DIR)/crt0.S.o $(ROOT_DIR)/printf.c.o $(ROOT_DIR)/string.c.o $(ROOT_DIR)/synchronization.c.o $(ROOT_DIR)/serial.c.o
+RUNTIME ?= $(ROOT_DIR)/crt0.S.o $(ROOT_DIR)/printf.c.o $(ROOT_DIR)/string.c.o $(ROOT_DIR)/synchronization.c.o $(ROOT_DIR)/serial.c.o $(ROOT_DIR)/perf_counters.c.o $(ROOT_DIR)/alloc.c.o $(ROOT_DIR)/parallel.c.o $(ROOT_DIR)/lock.c.o
 
 # For unit tests
 RISCV_CCFLAGS_TESTS ?= $(RISCV_FLAGS_GCC) $(RISCV_FLAGS_COMMON_TESTS) -fvisibility=hidden -nostdlib $(RISCV_LDFLAGS)
@@ -11,26 +11,307 @@
 #include "synchronization.h"
 
 uint32_t volatile barrier __attribute__((section(".l1")));
+// Incremented on every release of the barrier. Wake-ups stay pending until the
+// next WFI, so the waiting cores sleep until the epoch they arrived in is
+// over, instead of returning on a wake-up of earlier synchronization.
+uint32_t volatile barrier_epoch __attribute__((section(".l1")));
+
+// Whether core 0 initialized the barriers. The flag is in L2, which is zero
+// when the binary is loaded, unlike the NOLOAD sections in L1.
+static uint32_t volatile barrier_ready __attribute__((section(".data")));
+
+// Node of the hierarchical barriers, one per tile in the tile's banks. The tile
+// counter counts the cores of the tile, the group counter of the first tile
+// of a group its tiles, and the cluster counter of the first tile its groups.
+// The representatives are the cores that completed the tile or the group and
+// arrived at the next level, to be woken up on the release. The epochs count
+// the releases of every level, like barrier_epoch. fork counts the wake-ups of
+// mempool_team_wake_up() in the first tile of a team, and forks_seen the ones
+// every core of the tile returned from in mempool_team_wait().
+typedef struct {
+  uint32_t volatile tile;
+  uint32_t volatile group;
+  uint32_t volatile cluster;
+  uint32_t volatile tile_rep;
+  uint32_t volatile group_rep;
+  uint32_t volatile tile_epoch;
+  uint32_t volatile group_epoch;
+  uint32_t volatile cluster_epoch;
+  uint32_t volatile fork;
+  uint32_t volatile forks_seen[NUM_CORES_PER_TILE];
+} tree_barrier_t;
+
+// One node per team, and the last one for mempool_tree_barrier()
+#define TREE_BARRIER_CLUSTER MEMPOOL_NUM_TEAMS
+MEMPOOL_TILE_LOCAL(tree_barrier_t, tree_barrier[MEMPOOL_NUM_TEAMS + 1]);
+
+static inline tree_barrier_t *tree_barrier_node(uint32_t node,
+                                                uint32_t tile_id) {
+  return &tree_barrier[node][tile_id].value;
+}
+
+// Bottom word of the stack of every core, see arch.ld.c. An overflowing stack
+// overwrites it before corrupting the stack of the next core or, for the last
+// core of a tile, the tile's .l1_seq section.
+#define STACK_CANARY 0x5AFE57AC
+extern uint32_t __stack_canary;
+
+static inline uint32_t volatile *stack_canary(uint32_t core_id) {
+  uint32_t tile_id = mempool_get_tile_id(core_id);
+  uint32_t last = NUM_CORES_PER_TILE - 1 - core_id % NUM_CORES_PER_TILE;
+  return (uint32_t volatile *)((char *)mempool_tile_local(&__stack_canary,
+                                                           tile_id) +
+                               last * STACK_SIZE);
+}
+
+bool mempool_stack_check(uint32_t core_id) {
+  return *stack_canary(core_id) == STACK_CANARY;
+}
 
 void mempool_barrier_init(uint32_t core_id) {
   if (core_id == 0) {
-    // Initialize the barrier
+    // Initialize the barriers
     barrier = 0;
+    for (uint32_t c = 0; c < NUM_CORES; ++c) {
+      *stack_canary(c) = STACK_CANARY;
+    }
+    for (uint32_t t = 0; t < NUM_TILES; ++t) {
+      for (uint32_t i = 0; i <= MEMPOOL_NUM_TEAMS; ++i) {
+        tree_barrier_t *n = tree_barrier_node(i, t);
+        n->tile = 0;
+        n->group = 0;
+        n->cluster = 0;
+        n->fork = 0;
+        for (uint32_t c = 0; c < NUM_CORES_PER_TILE; ++c) {
+          n->forks_seen[c] = 0;
+        }
+      }
+    }
+    __sync_synchronize(); // Full memory barrier
+    barrier_ready = 1;
+    __sync_synchronize(); // Full memory barrier
     wake_up_all();
     mempool_wfi();
   } else {
+    while (!barrier_ready) {
+      mempool_wfi();
+    }
+    __sync_synchronize(); // Full memory barrier
+  }
+}
+
+// Sleeps until the epoch differs from the one the core arrived in
+static inline void barrier_wait_epoch(uint32_t volatile *epoch,
+                                      uint32_t arrived) {
+  while (*epoch == arrived) {
     mempool_wfi();
   }
 }
 
 void mempool_barrier(uint32_t num_cores) {
+  // The epoch cannot change before this core arrives, whose increment must not
+  // overtake the load
+  uint32_t epoch = barrier_epoch;
+  __sync_synchronize();
   // Increment the barrier counter
   if ((num_cores - 1) == __atomic_fetch_add(&barrier, 1, __ATOMIC_RELAXED)) {
     __atomic_store_n(&barrier, 0, __ATOMIC_RELAXED);
     __sync_synchronize(); // Full memory barrier
+    barrier_epoch = epoch + 1;
+    __sync_synchronize(); // Full memory barrier
     wake_up_all();
+    // Clear the wake-up trigger for the last core reaching the barrier as well
+    mempool_wfi();
+    return;
   }
   // Some threads have not reached the barrier --> Let's wait
-  // Clear the wake-up trigger for the last core reaching the barrier as well
-  mempool_wfi();
+  barrier_wait_epoch(&barrier_epoch, epoch);
+}
+
+// Arrives at a counter of the hierarchical barrier. Returns whether the core
+// is the last of the num arriving ones, which resets the counter for the next
+// barrier.
+static inline bool tree_barrier_arrive(uint32_t volatile *counter,
+                                       uint32_t num) {
+  if ((num - 1) == __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED)) {
+    *counter = 0;
+    return true;
+  }
+  return false;
+}
+
+static inline uint32_t tree_barrier_max(uint32_t a, uint32_t b) {
+  return a > b ? a : b;
+}
+
+static inline uint32_t tree_barrier_min(uint32_t a, uint32_t b) {
+  return a < b ? a : b;
+}
+
+// Hierarchical barrier of the cores first_core to first_core+num_cores-1 on
+// the given nodes
+static void tree_barrier_wait(uint32_t node, uint32_t first_core,
+                              uint32_t num_cores) {
+  uint32_t core_id = mempool_get_core_id();
+  uint32_t tile_id = mempool_get_tile_id(core_id);
+  uint32_t group_id = mempool_get_group_id(core_id);
+  uint32_t end_core = first_core + num_cores;
+  // Participating tiles and groups
+  uint32_t first_tile = mempool_get_tile_id(first_core);
+  uint32_t end_tile = mempool_get_tile_id(end_core - 1) + 1;
+  uint32_t first_group = mempool_get_group_id(first_core);
+  uint32_t end_group = mempool_get_group_id(end_core - 1) + 1;
+  // Participants of this tile and group
+  uint32_t tile_start =
+      tree_barrier_max(first_core, tile_id * NUM_CORES_PER_TILE);
+  uint32_t tile_end =
+      tree_barrier_min(end_core, (tile_id + 1) * NUM_CORES_PER_TILE);
+  uint32_t group_start =
+      tree_barrier_max(first_tile, group_id * NUM_TILES_PER_GROUP);
+  uint32_t group_end =
+      tree_barrier_min(end_tile, (group_id + 1) * NUM_TILES_PER_GROUP);
+  tree_barrier_t *tile = tree_barrier_node(node, tile_id);
+  tree_barrier_t *group = tree_barrier_node(node, group_start);
+  tree_barrier_t *cluster = tree_barrier_node(node, first_tile);
+  // With all cores, one broadcast releases everybody, wherever they wait
+  bool broadcast = first_core == 0 && num_cores == NUM_CORES;
+
+  // Arrive at the tile, the group, and the cluster. The representatives are
+  // written before arriving at the next level, where the releasing core reads
+  // them after the last arrival. The epoch of a level is read before arriving
+  // at it, as it cannot change before.
+  uint32_t volatile *epoch;
+  uint32_t arrived;
+  uint32_t level;
+  if (broadcast) {
+    epoch = &cluster->cluster_epoch;
+    arrived = cluster->cluster_epoch;
+  } else {
+    epoch = &tile->tile_epoch;
+    arrived = tile->tile_epoch;
+  }
+  __sync_synchronize();
+  if (!tree_barrier_arrive(&tile->tile, tile_end - tile_start)) {
+    level = 0;
+  } else {
+    tile->tile_rep = core_id;
+    if (!broadcast) {
+      epoch = &group->group_epoch;
+      arrived = group->group_epoch;
+    }
+    __sync_synchronize();
+    if (!tree_barrier_arrive(&group->group, group_end - group_start)) {
+      level = 1;
+    } else {
+      group->group_rep = core_id;
+      if (!broadcast) {
+        epoch = &cluster->cluster_epoch;
+        arrived = cluster->cluster_epoch;
+      }
+      __sync_synchronize();
+      if (!tree_barrier_arrive(&cluster->cluster, end_group - first_group)) {
+        level = 2;
+      } else {
+        level = 3;
+      }
+    }
+  }
+
+  if (broadcast) {
+    if (level == 3) {
+      __sync_synchronize(); // Full memory barrier
+      cluster->cluster_epoch = arrived + 1;
+      __sync_synchronize(); // Full memory barrier
+      wake_up_all();
+      // Clear the wake-up trigger for the last core reaching the barrier
+      mempool_wfi();
+    } else {
+      barrier_wait_epoch(epoch, arrived);
+    }
+    return;
+  }
+
+  // Wait to be released at the highest level reached, then release the levels
+  // below, skipping the nodes this core represents itself. The epoch of a
+  // level is incremented before its cores are woken up.
+  if (level < 3) {
+    barrier_wait_epoch(epoch, arrived);
+  }
+  __sync_synchronize(); // Full memory barrier
+  if (level == 3) {
+    cluster->cluster_epoch = arrived + 1;
+    __sync_synchronize(); // Full memory barrier
+    for (uint32_t g = first_group; g < end_group; ++g) {
+      if (g != group_id) {
+        uint32_t t = tree_barrier_max(first_tile, g * NUM_TILES_PER_GROUP);
+        wake_up(tree_barrier_node(node, t)->group_rep);
+      }
+    }
+  }
+  if (level >= 2) {
+    group->group_epoch = group->group_epoch + 1;
+    __sync_synchronize(); // Full memory barrier
+    for (uint32_t t = group_start; t < group_end; ++t) {
+      if (t != tile_id) {
+        wake_up(tree_barrier_node(node, t)->tile_rep);
+      }
+    }
+  }
+  if (level >= 1) {
+    tile->tile_epoch = tile->tile_epoch + 1;
+    __sync_synchronize(); // Full memory barrier
+    for (uint32_t c = tile_start; c < tile_end; ++c) {
+      if (c != core_id) {
+        wake_up(c);
+      }
+    }
+  }
+}
+
+void mempool_tree_barrier(uint32_t num_cores) {
+  tree_barrier_wait(TREE_BARRIER_CLUSTER, 0, num_cores);
+}
+
+void mempool_team_barrier(const mempool_team_t *team) {
+  // The counters of other teams or of the cluster must not be touched
+  if (team->id >= MEMPOOL_NUM_TEAMS || team->num_cores == 0) {
+    return;
+  }
+  tree_barrier_wait(team->id, team->first_core, team->num_cores);
+}
+
+void mempool_team_wake_up(const mempool_team_t *team) {
+  if (team->num_cores == 0) {
+    return;
+  }
+  uint32_t core_id = mempool_get_core_id();
+  tree_barrier_t *first =
+      tree_barrier_node(team->id, mempool_get_tile_id(team->first_core));
+  __sync_synchronize(); // Full memory barrier
+  first->fork = first->fork + 1;
+  __sync_synchronize(); // Full memory barrier
+  for (uint32_t c = team->first_core; c < team->first_core + team->num_cores;
+       ++c) {
+    if (c != core_id) {
+      wake_up(c);
+    }
+  }
+}
+
+void mempool_team_wait(const mempool_team_t *team) {
+  if (team->num_cores == 0) {
+    return;
+  }
+  uint32_t core_id = mempool_get_core_id();
+  tree_barrier_t *first =
+      tree_barrier_node(team->id, mempool_get_tile_id(team->first_core));
+  uint32_t volatile *seen =
+      &tree_barrier_node(team->id, mempool_get_tile_id(core_id))
+           ->forks_seen[core_id % NUM_CORES_PER_TILE];
+  uint32_t fork;
+  while ((fork = first->fork) == *seen) {
+    mempool_wfi();
+  }
+  *seen = fork;
+  __sync_synchronize(); // Full memory barrier
 }
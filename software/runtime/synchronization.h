@@ -7,8 +7,84 @@
 #ifndef __SYNCHRONIZATION_H__
 #define __SYNCHRONIZATION_H__
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "runtime.h"
+
 // Barrier functions
 void mempool_barrier_init(uint32_t core_id);
 void mempool_barrier(uint32_t num_cores);
 
+// Hierarchical barrier of the cores 0 to num_cores-1. The cores arrive at
+// counters in the banks of their tile, the last core of every tile
+// arrives at its group, and the last core of every group at the cluster. The
+// barrier is released with a broadcast if all cores take part, and otherwise
+// down the same tree with targeted wake-ups.
+void mempool_tree_barrier(uint32_t num_cores);
+
+// Whether the core's stack stayed within stack_size since
+// mempool_barrier_init(), to check, e.g., at the end of an application. An
+// overflowing stack corrupts the stack of the next core of the tile or the
+// tile's .l1_seq section. The check takes the bottom word of the stack.
+bool mempool_stack_check(uint32_t core_id);
+
+// Teams of consecutive cores, which synchronize independently of each other.
+// Every team uses the barrier counters of its id in the tiles it covers, so
+// teams that share a tile need different ids, while, e.g., all tile or group
+// teams can use the same id. The counters are initialized by
+// mempool_barrier_init().
+#define MEMPOOL_NUM_TEAMS 4
+
+typedef struct {
+  uint32_t id;
+  uint32_t first_core;
+  uint32_t num_cores;
+} mempool_team_t;
+
+/// Team of the cores first_core to first_core+num_cores-1. An id of
+/// MEMPOOL_NUM_TEAMS or above gives an empty team, without members.
+static inline mempool_team_t mempool_team_cores(uint32_t id,
+                                                uint32_t first_core,
+                                                uint32_t num_cores) {
+  mempool_team_t team = {id, first_core, num_cores};
+  if (id >= MEMPOOL_NUM_TEAMS) {
+    team.num_cores = 0;
+  }
+  return team;
+}
+
+/// Team of the cores of a tile.
+static inline mempool_team_t mempool_team_tile(uint32_t id, uint32_t tile_id) {
+  return mempool_team_cores(id, tile_id * NUM_CORES_PER_TILE,
+                            NUM_CORES_PER_TILE);
+}
+
+/// Team of the cores of a group.
+static inline mempool_team_t mempool_team_group(uint32_t id,
+                                                uint32_t group_id) {
+  return mempool_team_cores(id, group_id * NUM_CORES_PER_GROUP,
+                            NUM_CORES_PER_GROUP);
+}
+
+/// Whether the core belongs to the team.
+static inline bool mempool_team_member(const mempool_team_t *team,
+                                       uint32_t core_id) {
+  return core_id - team->first_core < team->num_cores;
+}
+
+// Hierarchical barrier of the team's cores, like mempool_tree_barrier(). Only
+// the team's cores are woken up.
+void mempool_team_barrier(const mempool_team_t *team);
+
+// Wakes up the other cores of the team, e.g., to fork work to them while they
+// wait in mempool_team_wait(). They join again in mempool_team_barrier().
+void mempool_team_wake_up(const mempool_team_t *team);
+
+// Sleeps until the next mempool_team_wake_up() of the team after the last one
+// the core returned from, or returns at once if it came already. Wake-ups of
+// other synchronization, which stay pending until the next WFI, do not end the
+// wait.
+void mempool_team_wait(const mempool_team_t *team);
+
 #endif // __SYNCHRONIZATION_H__
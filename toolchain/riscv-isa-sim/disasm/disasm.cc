@@ -2,6 +2,7 @@
 
 #include "disasm.h"
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <cstdarg>
@@ -431,6 +432,8 @@ std::string disassembler_t::disassemble(insn_t insn) const
 
 disassembler_t::disassembler_t(int xlen)
 {
+  memset(hashed, 0, sizeof(hashed));
+
   const uint32_t mask_rd = 0x1fUL << 7;
   const uint32_t match_rd_ra = 1UL << 7;
   const uint32_t mask_rs1 = 0x1fUL << 15;
@@ -1520,15 +1523,9 @@ disassembler_t::disassembler_t(int xlen)
 
 const disasm_insn_t* disassembler_t::lookup(insn_t insn) const
 {
-  size_t idx = insn.bits() % HASH_SIZE;
-  for (size_t j = 0; j < chain[idx].size(); j++)
-    if(*chain[idx][j] == insn)
-      return chain[idx][j];
-
-  idx = HASH_SIZE;
-  for (size_t j = 0; j < chain[idx].size(); j++)
-    if(*chain[idx][j] == insn)
-      return chain[idx][j];
+  for (const disasm_insn_t* candidate : table[key(insn.bits())])
+    if (*candidate == insn)
+      return candidate;
 
   return NULL;
 }
@@ -1539,6 +1536,21 @@ void NOINLINE disassembler_t::add_insn(disasm_insn_t* insn)
   if (insn->get_mask() % HASH_SIZE == HASH_SIZE - 1)
     idx = insn->get_match() % HASH_SIZE;
   chain[idx].push_back(insn);
+
+  // The instruction is a candidate for all keys that agree with its match,
+  // whatever the key bits outside of its mask
+  size_t mask = key(insn->get_mask());
+  size_t match = key(insn->get_match()) & mask;
+  size_t free = (KEY_ENTRIES - 1) & ~mask;
+  for (size_t bits = free; ; bits = (bits - 1) & free) {
+    size_t k = match | bits;
+    if (idx == HASH_SIZE)
+      table[k].push_back(insn);
+    else
+      table[k].insert(table[k].begin() + hashed[k]++, insn);
+    if (!bits)
+      break;
+  }
 }
 
 disassembler_t::~disassembler_t()
@@ -24,6 +24,7 @@
 #define IS_ELF_VCURRENT(hdr) (IS_ELF(hdr) && (hdr).e_version == EV_CURRENT)
 
 #define PT_LOAD 1
+#define PF_X 1
 
 #define SHT_NOBITS 8
 
@@ -15,7 +15,8 @@
 #include <vector>
 #include <map>
 
-std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t* entry)
+std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t* entry,
+                                         std::vector<std::pair<reg_t, reg_t>>* text)
 {
   int fd = open(fn, O_RDONLY);
   struct stat s;
@@ -52,6 +53,8 @@ std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t*
         } \
         zeros.resize(bswap(ph[i].p_memsz) - bswap(ph[i].p_filesz)); \
         memif->write(bswap(ph[i].p_paddr) + bswap(ph[i].p_filesz), bswap(ph[i].p_memsz) - bswap(ph[i].p_filesz), &zeros[0]); \
+        if (text && (bswap(ph[i].p_flags) & PF_X)) \
+          text->push_back(std::make_pair(bswap(ph[i].p_paddr), bswap(ph[i].p_paddr) + bswap(ph[i].p_memsz))); \
       } \
     } \
     shdr_t* sh = (shdr_t*)(buf + bswap(eh->e_shoff)); \
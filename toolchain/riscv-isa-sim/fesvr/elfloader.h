@@ -6,8 +6,12 @@
 #include "elf.h"
 #include <map>
 #include <string>
+#include <vector>
 
 class memif_t;
-std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t* entry);
+// Loads the segments of an ELF file and returns its symbols. With text, the
+// address ranges of the executable segments are appended to it.
+std::map<std::string, uint64_t> load_elf(const char* fn, memif_t* memif, reg_t* entry,
+                                         std::vector<std::pair<reg_t, reg_t>>* text = NULL);
 
 #endif
@@ -116,7 +116,7 @@ std::map<std::string, uint64_t> htif_t::load_payload(const std::string& payload,
     htif_t* htif;
   } preload_aware_memif(this);
 
-  return load_elf(path.c_str(), &preload_aware_memif, entry);
+  return load_elf(path.c_str(), &preload_aware_memif, entry, &text_segments);
 }
 
 void htif_t::load_program()
@@ -208,7 +208,7 @@ int htif_t::run()
     std::bind(enq_func, &fromhost_queue, std::placeholders::_1);
 
   if (tohost_addr == 0) {
-    while (true)
+    while (!signal_exit && exitcode == 0)
       idle();
   }
 
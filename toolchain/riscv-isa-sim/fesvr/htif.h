@@ -24,6 +24,9 @@ class htif_t : public chunked_memif_t
   int run();
   bool done();
   int exit_code();
+  // End the simulation with the given exit code, for targets that signal
+  // their end of computation through a device instead of tohost
+  void request_exit(int code) { exitcode = (uint32_t(code) << 1) | 1; }
 
   virtual memif_t& memif() { return mem; }
 
@@ -51,6 +54,9 @@ class htif_t : public chunked_memif_t
 
   // Given an address, return symbol from addr2symbol map
   const char* get_symbol(uint64_t addr);
+  const std::map<uint64_t, std::string>& get_symbols() { return addr2symbol; }
+  // Address ranges of the executable segments of the loaded programs
+  const std::vector<std::pair<reg_t, reg_t>>& get_text_segments() { return text_segments; }
 
  private:
   void parse_arguments(int argc, char ** argv);
@@ -79,6 +85,7 @@ class htif_t : public chunked_memif_t
   const std::vector<std::string>& target_args() { return targs; }
 
   std::map<uint64_t, std::string> addr2symbol;
+  std::vector<std::pair<reg_t, reg_t>> text_segments;
 
   friend class memif_t;
   friend class syscall_t;
@@ -87,3 +87,15 @@ void clint_t::increment(reg_t inc)
       procs[i]->state.mip |= MIP_MTIP;
   }
 }
+
+reg_t clint_t::time_to_next_timer()
+{
+  reg_t next = 0;
+  for (size_t i = 0; i < procs.size(); i++) {
+    if (!(procs[i]->state.mie & MIP_MTIP) || mtimecmp[i] <= mtime)
+      continue;
+    if (!next || mtimecmp[i] - mtime < next)
+      next = mtimecmp[i] - mtime;
+  }
+  return next;
+}
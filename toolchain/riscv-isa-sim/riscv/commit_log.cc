@@ -0,0 +1,231 @@
+// See LICENSE for license details.
+
+#include "commit_log.h"
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+static std::runtime_error file_error(const char* what, const std::string& path)
+{
+  std::ostringstream oss;
+  oss << what << " `" << path << "': " << strerror(errno);
+  return std::runtime_error(oss.str());
+}
+
+// Encoding of the records, see commit_log.h
+
+static const size_t header_size = 16;
+static const size_t block_header_size = 12;
+
+static void put_u32(uint8_t* p, uint32_t val)
+{
+  for (int i = 0; i < 4; i++)
+    p[i] = val >> (8 * i);
+}
+
+static uint32_t get_u32(const uint8_t* p)
+{
+  return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_varint(std::vector<uint8_t>& buf, uint64_t val)
+{
+  while (val >= 0x80) {
+    buf.push_back(val | 0x80);
+    val >>= 7;
+  }
+  buf.push_back(val);
+}
+
+static void put_signed(std::vector<uint8_t>& buf, uint64_t val)
+{
+  put_varint(buf, (val << 1) ^ (uint64_t)((int64_t)val >> 63));
+}
+
+static void put_record(std::vector<uint8_t>& buf, const commit_log_record_t& r,
+                       uint64_t& next_pc)
+{
+  uint8_t flags = r.flags & ~commit_log_record_t::PC_NEXT;
+  if (r.pc == next_pc)
+    flags |= commit_log_record_t::PC_NEXT;
+  buf.push_back(flags);
+  buf.push_back(r.priv);
+  if (!(flags & commit_log_record_t::PC_NEXT))
+    put_signed(buf, r.pc);
+  int length = (r.insn & 3) == 3 ? 4 : 2;
+  for (int i = 0; i < length; i++)
+    buf.push_back(r.insn >> (8 * i));
+  next_pc = r.pc + length;
+
+  if (flags & commit_log_record_t::REG_WRITE) {
+    put_varint(buf, r.reg);
+    put_signed(buf, r.reg_value);
+  }
+  if (flags & commit_log_record_t::LOAD) {
+    put_signed(buf, r.load_addr);
+    buf.push_back(r.load_size);
+  }
+  if (flags & commit_log_record_t::STORE) {
+    put_signed(buf, r.store_addr);
+    buf.push_back(r.store_size);
+    for (int i = 0; i < r.store_size && i < 8; i++)
+      buf.push_back(r.store_value >> (8 * i));
+  }
+}
+
+static std::runtime_error truncated()
+{
+  return std::runtime_error("Truncated commit log");
+}
+
+static uint8_t get_u8(const std::vector<uint8_t>& buf, size_t& pos)
+{
+  if (pos >= buf.size())
+    throw truncated();
+  return buf[pos++];
+}
+
+static uint64_t get_varint(const std::vector<uint8_t>& buf, size_t& pos)
+{
+  uint64_t val = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    uint8_t byte = get_u8(buf, pos);
+    val |= (uint64_t)(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return val;
+  }
+  throw std::runtime_error("Corrupt commit log");
+}
+
+static uint64_t get_signed(const std::vector<uint8_t>& buf, size_t& pos)
+{
+  uint64_t val = get_varint(buf, pos);
+  return (val >> 1) ^ -(val & 1);
+}
+
+commit_log_writer_t::commit_log_writer_t(const char* path)
+  : file(fopen(path, "wb")), path(path), failed(false)
+{
+  if (!file)
+    throw file_error("Failed to open commit log at", path);
+
+  uint8_t header[header_size] = {0};
+  strncpy((char*)header, COMMIT_LOG_MAGIC, 8);
+  put_u32(header + 8, COMMIT_LOG_VERSION);
+  if (fwrite(header, sizeof(header), 1, file) != 1) {
+    fclose(file);
+    throw file_error("Failed to write commit log at", path);
+  }
+}
+
+commit_log_writer_t::~commit_log_writer_t()
+{
+  if (fclose(file) != 0 && !failed)
+    fprintf(stderr, "Failed to write commit log at `%s'\n", path.c_str());
+}
+
+void commit_log_writer_t::write(uint32_t hart,
+                                const commit_log_record_t* records, size_t n)
+{
+  if (n == 0)
+    return;
+
+  // Encode outside of the lock, so the harts only wait for each other's
+  // fwrite
+  std::vector<uint8_t> buf(block_header_size);
+  buf.reserve(block_header_size + n * 16);
+  uint64_t next_pc = ~(uint64_t)0;
+  for (size_t i = 0; i < n; i++)
+    put_record(buf, records[i], next_pc);
+  put_u32(&buf[0], hart);
+  put_u32(&buf[4], n);
+  put_u32(&buf[8], buf.size() - block_header_size);
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (failed)
+    return;
+  if (fwrite(buf.data(), 1, buf.size(), file) != buf.size()) {
+    // Report once, the simulation goes on without the rest of the log
+    fprintf(stderr, "Failed to write commit log at `%s': %s\n", path.c_str(),
+            strerror(errno));
+    failed = true;
+  }
+}
+
+commit_log_reader_t::commit_log_reader_t(const char* path)
+  : file(fopen(path, "rb")), pos(0), records(0), hart(0), next_pc(0)
+{
+  if (!file)
+    throw file_error("Failed to open commit log at", path);
+
+  uint8_t header[header_size];
+  if (fread(header, sizeof(header), 1, file) != 1 ||
+      strncmp((char*)header, COMMIT_LOG_MAGIC, 8) != 0 ||
+      get_u32(header + 8) != COMMIT_LOG_VERSION) {
+    fclose(file);
+    std::ostringstream oss;
+    oss << "`" << path << "' is not a commit log of version "
+        << COMMIT_LOG_VERSION;
+    throw std::runtime_error(oss.str());
+  }
+}
+
+commit_log_reader_t::~commit_log_reader_t()
+{
+  fclose(file);
+}
+
+bool commit_log_reader_t::next(commit_log_record_t& record, uint32_t& hart)
+{
+  while (records == 0) {
+    if (pos != block.size())
+      throw std::runtime_error("Corrupt commit log");
+    uint8_t header[block_header_size];
+    size_t bytes = fread(header, 1, sizeof(header), file);
+    if (bytes == 0 && !ferror(file))
+      return false;
+    if (bytes != sizeof(header))
+      throw truncated();
+    block.resize(get_u32(header + 8));
+    if (fread(block.data(), 1, block.size(), file) != block.size())
+      throw truncated();
+    this->hart = get_u32(header);
+    records = get_u32(header + 4);
+    pos = 0;
+    next_pc = ~(uint64_t)0;
+  }
+
+  record = commit_log_record_t();
+  uint8_t flags = get_u8(block, pos);
+  record.flags = flags & ~commit_log_record_t::PC_NEXT;
+  record.priv = get_u8(block, pos);
+  record.pc = (flags & commit_log_record_t::PC_NEXT) ? next_pc :
+              get_signed(block, pos);
+  record.insn = get_u8(block, pos);
+  record.insn |= get_u8(block, pos) << 8;
+  if ((record.insn & 3) == 3) {
+    record.insn |= get_u8(block, pos) << 16;
+    record.insn |= (uint32_t)get_u8(block, pos) << 24;
+  }
+  next_pc = record.pc + ((record.insn & 3) == 3 ? 4 : 2);
+
+  if (flags & commit_log_record_t::REG_WRITE) {
+    record.reg = get_varint(block, pos);
+    record.reg_value = get_signed(block, pos);
+  }
+  if (flags & commit_log_record_t::LOAD) {
+    record.load_addr = get_signed(block, pos);
+    record.load_size = get_u8(block, pos);
+  }
+  if (flags & commit_log_record_t::STORE) {
+    record.store_addr = get_signed(block, pos);
+    record.store_size = get_u8(block, pos);
+    for (int i = 0; i < record.store_size && i < 8; i++)
+      record.store_value |= (uint64_t)get_u8(block, pos) << (8 * i);
+  }
+
+  records--;
+  hart = this->hart;
+  return true;
+}
@@ -0,0 +1,109 @@
+// See LICENSE for license details.
+
+// Binary commit log. Every retired instruction is described by one record.
+// The harts collect their records in buffers, which are appended to the file
+// as blocks, so the records of a hart are in order while the blocks of
+// different harts interleave. The file consists of
+//
+//   header: magic[8] version:u32 reserved:u32
+//   block:  hart:u32 records:u32 bytes:u32, followed by bytes of records
+//   ...
+//
+// with all integers in little-endian. A record is only as long as the fields
+// its flags select:
+//
+//   flags:u8 priv:u8 [pc:s] insn:u16 or u32 (by insn_length)
+//   [reg:u reg_value:s]              if REG_WRITE
+//   [load_addr:s load_size:u8]       if LOAD
+//   [store_addr:s store_size:u8 store_value:u8 * min(store_size, 8)]
+//                                    if STORE
+//
+// where u is an unsigned LEB128 varint and s the same of the zigzag-encoded
+// value, which keeps the sign-extended values of RV32 short. pc is left out if the flags have PC_NEXT set, i.e., if it follows the
+// previous instruction of the block. commit_log_reader_t streams the records
+// back, e.g., for the comparison with RTL traces.
+
+#ifndef _RISCV_COMMIT_LOG_H
+#define _RISCV_COMMIT_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define COMMIT_LOG_MAGIC   "SPKCLOG"
+#define COMMIT_LOG_VERSION 2
+
+// Records buffered per hart before they are written as one block
+#define COMMIT_LOG_BLOCK_RECORDS 1024
+
+struct commit_log_record_t {
+  // Values of flags
+  static const uint8_t REG_WRITE = 1 << 0;
+  static const uint8_t LOAD = 1 << 1;
+  static const uint8_t STORE = 1 << 2;
+  // The instruction wrote vector registers or accessed memory more often than
+  // the record holds, e.g., a vector load
+  static const uint8_t TRUNCATED = 1 << 3;
+  // Only set in the file, see above
+  static const uint8_t PC_NEXT = 1 << 7;
+
+  uint64_t pc;
+  // Value of the written x or f register, or else of the written CSR. Only
+  // the low 64 bits of an f register are kept.
+  uint64_t reg_value;
+  uint64_t load_addr;
+  uint64_t store_addr;
+  uint64_t store_value;
+  uint32_t insn;
+  // Register number << 4 | type like the keys of commit_log_reg_t, i.e.,
+  // 0 for x, 1 for f, and 4 for CSR
+  uint16_t reg;
+  uint8_t priv;
+  uint8_t flags;
+  // Bytes of the load and of the store
+  uint8_t load_size;
+  uint8_t store_size;
+};
+
+// Appends the blocks of all harts to one file. The harts may flush from
+// different host threads.
+class commit_log_writer_t {
+ public:
+  // Throws std::runtime_error if the file cannot be created
+  commit_log_writer_t(const char* path);
+  ~commit_log_writer_t();
+
+  void write(uint32_t hart, const commit_log_record_t* records, size_t n);
+
+ private:
+  FILE* file;
+  std::string path;
+  bool failed;
+  std::mutex mutex;
+};
+
+// Streams the records of a binary commit log, one block at a time
+class commit_log_reader_t {
+ public:
+  // Throws std::runtime_error if the file cannot be opened or is not a
+  // commit log of this version
+  commit_log_reader_t(const char* path);
+  ~commit_log_reader_t();
+
+  // Reads the next record and the hart that retired it. Returns false at the
+  // end of the log, and throws std::runtime_error if it is truncated.
+  bool next(commit_log_record_t& record, uint32_t& hart);
+
+ private:
+  FILE* file;
+  std::vector<uint8_t> block;
+  size_t pos;
+  uint32_t records;
+  uint32_t hart;
+  uint64_t next_pc;
+};
+
+#endif
@@ -72,6 +72,29 @@ const int NCSR = 4096;
 #define PC_ALIGN 2
 
 typedef uint64_t insn_bits_t;
+
+// Whether the instruction ends a basic block
+inline bool insn_is_control_flow(insn_bits_t insn)
+{
+  if ((insn & 3) == 3) {
+    switch (insn & 0x7f) {
+      case 0x63: // branches
+      case 0x67: // jalr
+      case 0x6f: // jal
+        return true;
+      case 0x73: // ecall, ebreak, xret, wfi
+        return (insn & 0x7000) == 0;
+    }
+    return false;
+  }
+
+  unsigned funct3 = (insn >> 13) & 7;
+  if ((insn & 3) == 1) // c.jal, c.j, c.beqz, c.bnez
+    return funct3 == 1 || funct3 == 5 || funct3 >= 6;
+  if ((insn & 3) == 2) // c.jr, c.jalr
+    return funct3 == 4 && ((insn >> 2) & 0x1f) == 0 && ((insn >> 7) & 0x1f) != 0;
+  return false;
+}
 class insn_t
 {
 public:
@@ -191,18 +214,23 @@ private:
     * 2 : vector reg
     * 3 : vector hint
     * 4 : csr
+    * The writes are only kept while the commits are logged.
     */
 # define WRITE_REG(reg, value) ({ \
     reg_t wdata = (value); /* value may have side effects */ \
-    STATE.log_reg_write[(reg) << 4] = {wdata, 0}; \
+    if (unlikely(p->get_log_commits_enabled())) \
+      STATE.log_reg_write[(reg) << 4] = {wdata, 0}; \
     STATE.XPR.write(reg, wdata); \
   })
 # define WRITE_FREG(reg, value) ({ \
     freg_t wdata = freg(value); /* value may have side effects */ \
-    STATE.log_reg_write[((reg) << 4) | 1] = wdata; \
+    if (unlikely(p->get_log_commits_enabled())) \
+      STATE.log_reg_write[((reg) << 4) | 1] = wdata; \
     DO_WRITE_FREG(reg, wdata); \
   })
-# define WRITE_VSTATUS STATE.log_reg_write[3] = {0, 0};
+# define WRITE_VSTATUS \
+  if (unlikely(p->get_log_commits_enabled())) \
+    STATE.log_reg_write[3] = {0, 0};
 #endif
 
 // RVC macros
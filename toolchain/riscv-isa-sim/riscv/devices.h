@@ -69,6 +69,10 @@ class clint_t : public abstract_device_t {
   bool store(reg_t addr, size_t len, const uint8_t* bytes);
   size_t size() { return CLINT_SIZE; }
   void increment(reg_t inc);
+  bool is_real_time() const { return real_time; }
+  // Ticks until the next timer interrupt that a hart enables, or 0 if there
+  // is none
+  reg_t time_to_next_timer();
  private:
   typedef uint64_t mtime_t;
   typedef uint64_t mtimecmp_t;
@@ -97,6 +97,15 @@ class disassembler_t
  private:
   static const int HASH_SIZE = 256;
   std::vector<const disasm_insn_t*> chain[HASH_SIZE+1];
+
+  // Decode table over the opcode bits 6:0 and the funct3 bits 15:12. Each
+  // entry lists the instructions that can match such bits, in the order of
+  // the chains, i.e., those of the hash chains before those of the last one.
+  static const size_t KEY_ENTRIES = 1 << 11;
+  static size_t key(insn_bits_t bits) { return (bits & 0x7f) | ((bits >> 5) & 0x780); }
+  std::vector<const disasm_insn_t*> table[KEY_ENTRIES];
+  // Instructions of the hash chain at the start of every table entry
+  size_t hashed[KEY_ENTRIES];
 };
 
 #endif
@@ -155,16 +155,67 @@ static void commit_log_print_insn(processor_t *p, reg_t pc, insn_t insn)
   }
   fprintf(log_file, "\n");
 }
-#else
-static void commit_log_reset(processor_t* p) {}
-static void commit_log_stash_privilege(processor_t* p) {}
-static void commit_log_print_insn(processor_t* p, reg_t pc, insn_t insn) {}
+
+// Binary counterpart of commit_log_print_insn, see commit_log.h
+static void commit_log_record_insn(processor_t *p, reg_t pc, insn_t insn)
+{
+  state_t* state = p->get_state();
+  commit_log_record_t* record = p->next_commit_record();
+  record->pc = pc;
+  record->insn = insn.bits();
+  record->priv = state->last_inst_priv;
+
+  for (auto& item : state->log_reg_write) {
+    int type = item.first & 0xf;
+    if (item.first == 0) {
+      continue;
+    } else if (type != 0 && type != 1 && type != 4) {
+      record->flags |= commit_log_record_t::TRUNCATED;
+    } else if (!(record->flags & commit_log_record_t::REG_WRITE) ||
+               (type != 4 && (record->reg & 0xf) == 4)) {
+      // The x and f registers take precedence over the CSRs
+      record->flags |= commit_log_record_t::REG_WRITE;
+      record->reg = item.first;
+      record->reg_value = item.second.v[0];
+    }
+  }
+
+  auto& load = state->log_mem_read;
+  if (!load.empty()) {
+    record->flags |= commit_log_record_t::LOAD;
+    record->load_addr = std::get<0>(load[0]);
+    record->load_size = std::get<2>(load[0]);
+  }
+  auto& store = state->log_mem_write;
+  if (!store.empty()) {
+    record->flags |= commit_log_record_t::STORE;
+    record->store_addr = std::get<0>(store[0]);
+    record->store_value = std::get<1>(store[0]);
+    record->store_size = std::get<2>(store[0]);
+  }
+  if (load.size() > 1 || store.size() > 1)
+    record->flags |= commit_log_record_t::TRUNCATED;
+}
+
+static void commit_log_insn(processor_t *p, reg_t pc, insn_t insn)
+{
+  if (p->get_commit_log())
+    commit_log_record_insn(p, pc, insn);
+  else
+    commit_log_print_insn(p, pc, insn);
+}
 #endif
 
 inline void processor_t::update_histogram(reg_t pc)
 {
 #ifdef RISCV_ENABLE_HISTOGRAM
-  pc_histogram[pc]++;
+  if (histogram_enabled) {
+    reg_t i = (pc - histogram_base) / 2;
+    if (likely(i < pc_counts.size()))
+      pc_counts[i]++;
+    else
+      pc_histogram[pc]++;
+  }
 #endif
 }
 
@@ -173,17 +224,23 @@ inline void processor_t::update_histogram(reg_t pc)
 // function calls.
 static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
 {
-  commit_log_reset(p);
-  commit_log_stash_privilege(p);
+#ifdef RISCV_ENABLE_COMMITLOG
+  if (unlikely(p->get_log_commits_enabled())) {
+    commit_log_reset(p);
+    commit_log_stash_privilege(p);
+  }
+#endif
   reg_t npc;
 
   try {
     npc = fetch.func(p, fetch.insn, pc);
     if (npc != PC_SERIALIZE_BEFORE) {
+      // Serialized instructions run again and are counted then
+      p->update_histogram(pc);
 
 #ifdef RISCV_ENABLE_COMMITLOG
-      if (p->get_log_commits_enabled()) {
-        commit_log_print_insn(p, pc, fetch.insn);
+      if (unlikely(p->get_log_commits_enabled())) {
+        commit_log_insn(p, pc, fetch.insn);
       }
 #endif
 
@@ -194,7 +251,7 @@ static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
       if (p->get_log_commits_enabled()) {
         for (auto item : p->get_state()->log_reg_write) {
           if ((item.first & 3) == 3) {
-            commit_log_print_insn(p, pc, fetch.insn);
+            commit_log_insn(p, pc, fetch.insn);
             break;
           }
         }
@@ -204,7 +261,6 @@ static reg_t execute_insn(processor_t* p, reg_t pc, insn_fetch_t fetch)
   } catch(...) {
     throw;
   }
-  p->update_histogram(pc);
 
   return npc;
 }
@@ -217,6 +273,9 @@ bool processor_t::slow_path()
 // fetch/decode/execute loop
 void processor_t::step(size_t n)
 {
+  if (is_sleeping())
+    return;
+
   if (!state.debug_mode) {
     if (halt_request == HR_REGULAR) {
       enter_debug_mode(DCSR_CAUSE_DEBUGINT);
@@ -229,7 +288,9 @@ void processor_t::step(size_t n)
   }
 
   while (n > 0) {
-    size_t instret = 0;
+    // Kept in the hart such that get_instret() is exact in the middle of a step
+    size_t& instret = step_instret;
+    instret = 0;
     reg_t pc = state.pc;
     mmu_t* _mmu = mmu;
 
@@ -278,6 +339,31 @@ void processor_t::step(size_t n)
       }
       else while (instret < n)
       {
+        // The instructions of a basic block are dispatched from its array
+        // until a branch is taken or the block ends. Like in the Duff's
+        // Device below, each position in the block has its own call point.
+        if (auto block = _mmu->access_block(pc)) {
+          #define BLOCK_ACCESS(i) { \
+            pc = execute_insn(this, pc, block->insns[i].fetch); \
+            if (i == MAX_BLOCK_INSNS-1) break; \
+            if (unlikely(block->len <= i+1)) break; \
+            if (unlikely(block->insns[i+1].pc != pc)) break; \
+            if (unlikely(instret+1 == n)) break; \
+            instret++; \
+            state.pc = pc; \
+          }
+
+          do {
+            BLOCK_ACCESS(0) BLOCK_ACCESS(1) BLOCK_ACCESS(2) BLOCK_ACCESS(3)
+            BLOCK_ACCESS(4) BLOCK_ACCESS(5) BLOCK_ACCESS(6) BLOCK_ACCESS(7)
+            BLOCK_ACCESS(8) BLOCK_ACCESS(9) BLOCK_ACCESS(10) BLOCK_ACCESS(11)
+            BLOCK_ACCESS(12) BLOCK_ACCESS(13) BLOCK_ACCESS(14) BLOCK_ACCESS(15)
+          } while (0);
+
+          advance_pc();
+          continue;
+        }
+
         // This code uses a modified Duff's Device to improve the performance
         // of executing instructions. While typical Duff's Devices are used
         // for software pipelining, the switch statement below primarily
@@ -373,9 +459,22 @@ void processor_t::step(size_t n)
       // allows us to switch to other threads only once per idle loop in case
       // there is activity.
       n = instret;
+
+      if (state.debug_mode) {
+        // The debug ROM waits in a loop
+      } else if (wfi_parking) {
+        if (wake_up_pending)
+          wake_up_pending = false;
+        else
+          parked = true;
+      } else if (state.mie) {
+        // Without an enabled interrupt, the WFI does not wait
+        parked = true;
+      }
     }
 
     state.minstret += instret;
     n -= instret;
+    instret = 0;
   }
 }
@@ -0,0 +1 @@
+MMU.fence();
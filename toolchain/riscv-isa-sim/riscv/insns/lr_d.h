@@ -1,5 +1,4 @@
 require_extension('A');
 require_rv64;
-auto res = MMU.load_int64(RS1);
-MMU.acquire_load_reservation(RS1);
+auto res = MMU.load_reserved_int64(RS1);
 WRITE_RD(res);
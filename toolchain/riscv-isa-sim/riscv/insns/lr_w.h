@@ -1,4 +1,3 @@
 require_extension('A');
-auto res = MMU.load_int32(RS1);
-MMU.acquire_load_reservation(RS1);
+auto res = MMU.load_reserved_int32(RS1);
 WRITE_RD(res);
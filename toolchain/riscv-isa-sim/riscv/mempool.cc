@@ -0,0 +1,130 @@
+// See LICENSE for license details.
+
+#include "mempool.h"
+#include "processor.h"
+#include "sim.h"
+#include <cstdio>
+#include <cstring>
+
+mempool_ctrl_t::mempool_ctrl_t(sim_t* sim, std::vector<processor_t*> procs,
+                               reg_t tcdm_start, reg_t tcdm_end)
+  : sim(sim), procs(procs)
+{
+  memset(regs, 0, sizeof(regs));
+  regs[TCDM_START] = tcdm_start;
+  regs[TCDM_END] = tcdm_end;
+  regs[NR_CORES] = procs.size();
+}
+
+bool mempool_ctrl_t::load(reg_t addr, size_t len, uint8_t* bytes)
+{
+  size_t reg = addr / sizeof(uint32_t);
+  if (!valid_access(addr, len))
+    return false;
+  memcpy(bytes, (uint8_t*)&regs[reg] + addr % sizeof(uint32_t), len);
+  return true;
+}
+
+bool mempool_ctrl_t::store(reg_t addr, size_t len, const uint8_t* bytes)
+{
+  size_t reg = addr / sizeof(uint32_t);
+  if (!valid_access(addr, len))
+    return false;
+
+  // The TCDM bounds and the number of cores are read-only
+  if (reg != EOC && reg != WAKE_UP)
+    return true;
+  memcpy((uint8_t*)&regs[reg] + addr % sizeof(uint32_t), bytes, len);
+
+  if (reg == WAKE_UP) {
+    if (wake_up_callback)
+      wake_up_callback(regs[WAKE_UP]);
+    wake_up(regs[WAKE_UP]);
+  } else if (regs[EOC] & 1) {
+    // Same encoding as tohost: the return value is in the upper bits
+    sim->request_exit(regs[EOC] >> 1);
+  }
+  return true;
+}
+
+bool mempool_ctrl_t::valid_access(reg_t addr, size_t len)
+{
+  // Accesses must stay within one of the registers
+  return addr % sizeof(uint32_t) + len <= sizeof(uint32_t) &&
+         addr / sizeof(uint32_t) < NUM_REGS;
+}
+
+void mempool_ctrl_t::wake_up(uint32_t core_id)
+{
+  // Wakes up a single core or, for all bits set, all of them
+  if (core_id < procs.size()) {
+    procs[core_id]->wake_up();
+  } else if (core_id == uint32_t(-1)) {
+    for (processor_t* proc : procs)
+      proc->wake_up();
+  }
+}
+
+mempool_uart_t::~mempool_uart_t()
+{
+  if (!line.empty())
+    printf("[UART] %s\n", line.c_str());
+}
+
+bool mempool_uart_t::load(reg_t addr, size_t len, uint8_t* bytes)
+{
+  memset(bytes, 0, len);
+  return true;
+}
+
+bool mempool_uart_t::store(reg_t addr, size_t len, const uint8_t* bytes)
+{
+  for (size_t i = 0; i < len; i++) {
+    if (bytes[i] == '\n') {
+      printf("[UART] %s\n", line.c_str());
+      line.clear();
+    } else {
+      line += bytes[i];
+    }
+  }
+  return true;
+}
+
+mempool_t::mempool_t(sim_t* sim, mem_t* l1, reg_t l2_base, size_t num_groups)
+  : num_groups(num_groups)
+{
+  std::vector<processor_t*> procs;
+  for (size_t i = 0; i < sim->nprocs(); i++)
+    procs.push_back(sim->get_core(i));
+
+  // Same program as software/runtime/bootrom.S
+  int32_t hi = (l2_base + 0x800) >> 12;
+  int32_t lo = l2_base - (reg_t(hi) << 12);
+  uint32_t bootrom[] = {
+    (uint32_t(hi) << 12) | 0x537,   // lui  a0, %hi(l2_base)
+    (uint32_t(lo) << 20) | 0x50513, // addi a0, a0, %lo(l2_base)
+    0x10500073,                     // wfi
+    0x50067,                        // jr   a0
+  };
+  std::vector<char> rom((char*)bootrom, (char*)bootrom + sizeof(bootrom));
+  rom.resize(0x1000);
+
+  boot_rom.reset(new rom_device_t(rom));
+  ctrl.reset(new mempool_ctrl_t(sim, procs, MEMPOOL_L1_BASE,
+                                MEMPOOL_L1_BASE + l1->size()));
+  uart.reset(new mempool_uart_t());
+  // The L1 takes the place of the debug module, which MemPool does not have
+  sim->add_device(MEMPOOL_L1_BASE, l1);
+  sim->add_device(MEMPOOL_BOOT_ADDR, boot_rom.get());
+  sim->add_device(MEMPOOL_CTRL_BASE, ctrl.get());
+  sim->add_device(MEMPOOL_UART_BASE, uart.get());
+
+  for (processor_t* proc : procs) {
+    proc->set_reset_pc(MEMPOOL_BOOT_ADDR);
+    proc->set_wfi_parking(true);
+  }
+
+  // The host wakes up all cores once the binary is loaded. The wake-up is
+  // latched until the cores reach the WFI of the boot ROM.
+  ctrl->wake_up(uint32_t(-1));
+}
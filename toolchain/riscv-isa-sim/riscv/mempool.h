@@ -0,0 +1,81 @@
+// See LICENSE for license details.
+
+// Machine model of the MemPool cluster for functional simulation. It mirrors
+// the memory map of software/runtime/arch.ld.c and the control registers of
+// hardware/src/ctrl_registers.sv, such that the binaries of software/bin run
+// unmodified.
+
+#ifndef _RISCV_MEMPOOL_H
+#define _RISCV_MEMPOOL_H
+
+#include "devices.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class processor_t;
+class sim_t;
+
+#define MEMPOOL_L1_BASE          0x00000000
+#define MEMPOOL_L1_SIZE_PER_CORE 0x1000
+#define MEMPOOL_CTRL_BASE        0x40000000
+#define MEMPOOL_L2_BASE          0x80000000
+#define MEMPOOL_L2_SIZE          0x10000
+#define MEMPOOL_BOOT_ADDR        0xA0000000
+#define MEMPOOL_UART_BASE        0xC0000000
+#define MEMPOOL_NUM_CORES        256
+#define MEMPOOL_NUM_GROUPS       4
+
+// Control registers, one word each
+class mempool_ctrl_t : public abstract_device_t {
+ public:
+  mempool_ctrl_t(sim_t* sim, std::vector<processor_t*> procs,
+                 reg_t tcdm_start, reg_t tcdm_end);
+  bool load(reg_t addr, size_t len, uint8_t* bytes);
+  bool store(reg_t addr, size_t len, const uint8_t* bytes);
+  void wake_up(uint32_t core_id);
+  // Called with the core ID of every wake-up that a hart writes, before the
+  // cores wake up
+  void set_wake_up_callback(std::function<void(uint32_t)> callback)
+  {
+    wake_up_callback = callback;
+  }
+
+ private:
+  enum { EOC, WAKE_UP, TCDM_START, TCDM_END, NR_CORES, NUM_REGS };
+  bool valid_access(reg_t addr, size_t len);
+  sim_t* sim;
+  std::vector<processor_t*> procs;
+  std::function<void(uint32_t)> wake_up_callback;
+  uint32_t regs[NUM_REGS];
+};
+
+// Prints the characters written to it line by line, like tb/axi_uart.sv
+class mempool_uart_t : public abstract_device_t {
+ public:
+  ~mempool_uart_t();
+  bool load(reg_t addr, size_t len, uint8_t* bytes);
+  bool store(reg_t addr, size_t len, const uint8_t* bytes);
+
+ private:
+  std::string line;
+};
+
+// Memories and devices of the cluster. The harts start in the boot ROM, where
+// they wait in WFI until the host wakes them up to jump to the binary in L2.
+// The cores of the simulation are split evenly into num_groups groups.
+class mempool_t {
+ public:
+  mempool_t(sim_t* sim, mem_t* l1, reg_t l2_base, size_t num_groups);
+  mempool_ctrl_t* get_ctrl() { return ctrl.get(); }
+  size_t get_num_groups() { return num_groups; }
+
+ private:
+  size_t num_groups;
+  std::unique_ptr<rom_device_t> boot_rom;
+  std::unique_ptr<mempool_ctrl_t> ctrl;
+  std::unique_ptr<mempool_uart_t> uart;
+};
+
+#endif
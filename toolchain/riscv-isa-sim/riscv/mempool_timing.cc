@@ -0,0 +1,394 @@
+// See LICENSE for license details.
+
+#include "mempool_timing.h"
+#include "mempool.h"
+#include "mmu.h"
+#include "processor.h"
+#include "sim.h"
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+
+bool mempool_timing_port_t::interested_in_range(uint64_t begin, uint64_t end,
+                                              access_type type)
+{
+  return timing->interested_in_range(begin, end, type);
+}
+
+void mempool_timing_port_t::trace(uint64_t addr, size_t bytes, access_type type)
+{
+  if (type == FETCH)
+    timing->fetch(hart, addr);
+  else
+    timing->access(hart, addr, type);
+}
+
+mempool_timing_t::counters_t
+mempool_timing_t::counters_t::operator-(const counters_t& start) const
+{
+  counters_t diff;
+  diff.instret = instret - start.instret;
+  diff.cycles = cycles - start.cycles;
+  diff.loads = loads - start.loads;
+  diff.stores = stores - start.stores;
+  diff.local = local - start.local;
+  diff.group = group - start.group;
+  diff.remote = remote - start.remote;
+  diff.conflicts = conflicts - start.conflicts;
+  diff.latency_stalls = latency_stalls - start.latency_stalls;
+  diff.conflict_stalls = conflict_stalls - start.conflict_stalls;
+  diff.fetch_stalls = fetch_stalls - start.fetch_stalls;
+  return diff;
+}
+
+mempool_timing_t::mempool_timing_t(sim_t* sim, mempool_t* mempool,
+                                   reg_t l1_size, const char* stats_path)
+  : harts(sim->nprocs()), mempool(mempool), l1_size(l1_size),
+    stats_path(stats_path)
+{
+  num_tiles = (sim->nprocs() + MEMPOOL_CORES_PER_TILE - 1) /
+              MEMPOOL_CORES_PER_TILE;
+  tiles.resize(num_tiles);
+  for (tile_t& t : tiles)
+    t.icache.resize(MEMPOOL_ICACHE_SIZE / MEMPOOL_ICACHE_LINE_SIZE);
+  tiles_per_group = std::max<size_t>(num_tiles / mempool->get_num_groups(), 1);
+  busy.resize(num_tiles * MEMPOOL_BANKS_PER_TILE * WINDOW_WORDS);
+  busy_tag.resize(busy.size());
+
+  for (size_t i = 0; i < harts.size(); i++) {
+    hart_t& h = harts[i];
+    h.proc = sim->get_core(i);
+    h.port.reset(new mempool_timing_port_t(this, i));
+    h.tile = i / MEMPOOL_CORES_PER_TILE;
+    h.proc->get_mmu()->register_memtracer(h.port.get());
+    h.proc->set_trace_callback([this, i](reg_t val) { trace_written(i, val); });
+  }
+  mempool->get_ctrl()->set_wake_up_callback(
+      [this](uint32_t core_id) { woken_up(core_id); });
+}
+
+mempool_timing_t::~mempool_timing_t()
+{
+  for (hart_t& h : harts)
+    h.proc->set_trace_callback(nullptr);
+  mempool->get_ctrl()->set_wake_up_callback(nullptr);
+  print_stats();
+  if (stats_path)
+    write_stats();
+}
+
+bool mempool_timing_t::interested_in_range(uint64_t begin, uint64_t end,
+                                         access_type type)
+{
+  // The instruction caches see all fetches
+  if (type == FETCH)
+    return true;
+  return begin < MEMPOOL_L1_BASE + l1_size && end > MEMPOOL_L1_BASE;
+}
+
+mempool_timing_t::counters_t& mempool_timing_t::update(hart_t& h)
+{
+  h.total.instret = h.proc->get_instret();
+  h.total.cycles = h.total.instret + h.total.latency_stalls +
+                   h.total.conflict_stalls + h.total.fetch_stalls + h.idle;
+  return h.total;
+}
+
+void mempool_timing_t::access(size_t hart, uint64_t addr, access_type type)
+{
+  hart_t& h = harts[hart];
+  if (addr < MEMPOOL_L1_BASE || addr >= MEMPOOL_L1_BASE + l1_size)
+    return;
+
+  counters_t& c = update(h);
+  size_t tile;
+  size_t bank = map(addr - MEMPOOL_L1_BASE, &tile);
+  uint64_t latency;
+  if (tile == h.tile) {
+    latency = MEMPOOL_LATENCY_LOCAL;
+    c.local++;
+  } else if (tile / tiles_per_group == h.tile / tiles_per_group) {
+    latency = MEMPOOL_LATENCY_GROUP;
+    c.group++;
+  } else {
+    latency = MEMPOOL_LATENCY_REMOTE;
+    c.remote++;
+  }
+
+  // The request takes about half of the latency to reach the bank
+  uint64_t arrival = c.cycles + latency / 2;
+  uint64_t stall = arbitrate(bank, arrival) - arrival;
+  if (stall) {
+    c.conflicts++;
+    c.conflict_stalls += stall;
+  }
+
+  // Stores do not wait for a response, loads and AMOs take the latency
+  // instead of a single cycle
+  if (type == STORE) {
+    c.stores++;
+  } else {
+    c.loads++;
+    c.latency_stalls += latency - 1;
+  }
+}
+
+void mempool_timing_t::fetch(size_t hart, uint64_t addr)
+{
+  hart_t& h = harts[hart];
+  tile_t& t = tiles[h.tile];
+  uint64_t cycle = now(h);
+  running = hart;
+  uint64_t line = addr / MEMPOOL_ICACHE_LINE_SIZE;
+
+  t.l0_accesses++;
+  uint64_t ready;
+  if (icache_line_t* l0 = l0_lookup(h, line)) {
+    ready = l0->ready;
+    // Like the L0 of snitch_icache, a hit prefetches the next line
+    if (!l0_lookup(h, line + 1))
+      l0_refill(h, line + 1, cycle);
+  } else {
+    t.l0_misses++;
+    ready = l0_refill(h, line, cycle);
+  }
+
+  if (ready > cycle) {
+    h.total.fetch_stalls += ready - cycle;
+    t.fetch_stalls += ready - cycle;
+  }
+}
+
+mempool_timing_t::icache_line_t* mempool_timing_t::l0_lookup(hart_t& h,
+                                                             uint64_t line)
+{
+  for (icache_line_t& l0 : h.l0)
+    if (l0.valid && l0.line == line)
+      return &l0;
+  return NULL;
+}
+
+uint64_t mempool_timing_t::l0_refill(hart_t& h, uint64_t line, uint64_t cycle)
+{
+  // The L0 evicts its lines round robin
+  icache_line_t& l0 = h.l0[h.l0_next];
+  h.l0_next = (h.l0_next + 1) % MEMPOOL_ICACHE_L0_LINES;
+  l0.valid = true;
+  l0.line = line;
+  l0.ready = l1_lookup(tiles[h.tile], line, cycle);
+  return l0.ready;
+}
+
+uint64_t mempool_timing_t::l1_lookup(tile_t& t, uint64_t line, uint64_t cycle)
+{
+  const size_t sets = t.icache.size() / MEMPOOL_ICACHE_WAYS;
+  icache_line_t* set = &t.icache[line % sets * MEMPOOL_ICACHE_WAYS];
+
+  t.l1_accesses++;
+  for (size_t way = 0; way < MEMPOOL_ICACHE_WAYS; way++) {
+    // A line that is still being refilled is ready when the refill completes
+    if (set[way].valid && set[way].line == line)
+      return std::max(set[way].ready, cycle + MEMPOOL_ICACHE_L1_LATENCY);
+  }
+
+  // The L1 evicts a random way
+  t.l1_misses++;
+  icache_line_t& victim = set[t.lfsr.next() % MEMPOOL_ICACHE_WAYS];
+  victim.valid = true;
+  victim.line = line;
+  victim.ready = cycle + MEMPOOL_ICACHE_REFILL_LATENCY;
+  return victim.ready;
+}
+
+void mempool_timing_t::woken_up(uint32_t core_id)
+{
+  // The harts do not retire instructions while they sleep, so they are late
+  // when they wake up. They catch up with the hart that wakes them, whose
+  // store was fetched last. A core that does not sleep yet keeps the wake-up
+  // pending and does not wait for it.
+  uint64_t cycle = now(harts[running]);
+  auto catch_up = [this, cycle](hart_t& h) {
+    if (h.proc->is_sleeping()) {
+      uint64_t late = now(h);
+      if (late < cycle)
+        h.idle += cycle - late;
+    }
+  };
+  if (core_id < harts.size()) {
+    catch_up(harts[core_id]);
+  } else if (core_id == uint32_t(-1)) {
+    for (hart_t& h : harts)
+      catch_up(h);
+  }
+}
+
+void mempool_timing_t::trace_written(size_t hart, reg_t val)
+{
+  hart_t& h = harts[hart];
+  const counters_t& c = update(h);
+  if (val && !h.in_region) {
+    h.region_start = c;
+    h.in_region = true;
+  } else if (!val && h.in_region) {
+    h.regions.push_back(c - h.region_start);
+    h.in_region = false;
+  }
+}
+
+size_t mempool_timing_t::map(reg_t addr, size_t* tile)
+{
+  // Like address_scrambler.sv, the first SeqMemSizePerTile bytes of every tile
+  // form a sequential region at the start of the L1. The rest is interleaved
+  // across the tiles.
+  const reg_t seq_size_per_tile = MEMPOOL_CORES_PER_TILE * MEMPOOL_BANK_SIZE;
+  const reg_t bank_width = 4;
+  if (addr < num_tiles * seq_size_per_tile)
+    *tile = addr / seq_size_per_tile;
+  else
+    *tile = addr / (bank_width * MEMPOOL_BANKS_PER_TILE) % num_tiles;
+  return *tile * MEMPOOL_BANKS_PER_TILE +
+         addr / bank_width % MEMPOOL_BANKS_PER_TILE;
+}
+
+uint64_t mempool_timing_t::arbitrate(size_t bank, uint64_t cycle)
+{
+  // Grants the first cycle in which the bank is free
+  for (;; cycle++) {
+    uint64_t tag = cycle / 64;
+    size_t i = bank * WINDOW_WORDS + tag % WINDOW_WORDS;
+    if (busy_tag[i] > tag) {
+      // Older than the window, where the bank is assumed to be free
+      return cycle;
+    }
+    if (busy_tag[i] < tag) {
+      busy_tag[i] = tag;
+      busy[i] = 0;
+    }
+    uint64_t bit = uint64_t(1) << (cycle % 64);
+    if (!(busy[i] & bit)) {
+      busy[i] |= bit;
+      return cycle;
+    }
+  }
+}
+
+void mempool_timing_t::print_stats()
+{
+  counters_t sum;
+  uint64_t cycles = 0;
+  for (hart_t& h : harts) {
+    const counters_t& c = update(h);
+    cycles = std::max(cycles, c.cycles);
+    sum.loads += c.loads;
+    sum.stores += c.stores;
+    sum.local += c.local;
+    sum.group += c.group;
+    sum.remote += c.remote;
+    sum.conflicts += c.conflicts;
+    sum.conflict_stalls += c.conflict_stalls;
+  }
+  tile_t isum;
+  for (tile_t& t : tiles) {
+    isum.l0_accesses += t.l0_accesses;
+    isum.l0_misses += t.l0_misses;
+    isum.l1_accesses += t.l1_accesses;
+    isum.l1_misses += t.l1_misses;
+    isum.fetch_stalls += t.fetch_stalls;
+  }
+  if (isum.l0_accesses == 0)
+    return;
+
+  std::cout << std::setprecision(3) << std::fixed;
+  std::cout << "Cycles:                    " << cycles << std::endl;
+  std::cout << "TCDM Loads:                " << sum.loads << std::endl;
+  std::cout << "TCDM Stores:               " << sum.stores << std::endl;
+  std::cout << "TCDM Local Accesses:       " << sum.local << std::endl;
+  std::cout << "TCDM Group Accesses:       " << sum.group << std::endl;
+  std::cout << "TCDM Remote Accesses:      " << sum.remote << std::endl;
+  std::cout << "TCDM Bank Conflicts:       " << sum.conflicts << std::endl;
+  std::cout << "TCDM Conflict Stalls:      " << sum.conflict_stalls << std::endl;
+  std::cout << "I$ L0 Accesses:            " << isum.l0_accesses << std::endl;
+  std::cout << "I$ L0 Miss Rate:           "
+            << 100.0 * isum.l0_misses / isum.l0_accesses << '%' << std::endl;
+  std::cout << "I$ L1 Accesses:            " << isum.l1_accesses << std::endl;
+  std::cout << "I$ L1 Miss Rate:           "
+            << 100.0 * isum.l1_misses / std::max<uint64_t>(isum.l1_accesses, 1)
+            << '%' << std::endl;
+  std::cout << "I$ Fetch Stalls:           " << isum.fetch_stalls << std::endl;
+
+  // A region lasts until its slowest hart leaves it
+  for (size_t r = 0;; r++) {
+    uint64_t region_cycles = 0;
+    bool found = false;
+    for (hart_t& h : harts) {
+      if (r < h.regions.size()) {
+        region_cycles = std::max(region_cycles, h.regions[r].cycles);
+        found = true;
+      }
+    }
+    if (!found)
+      break;
+    std::cout << "Region " << r << " Cycles:           " << region_cycles
+              << std::endl;
+  }
+}
+
+static void write_counters(FILE* f, const char* indent, const char* fmt,
+                           uint64_t value)
+{
+  fprintf(f, "%s", indent);
+  fprintf(f, fmt, (unsigned long long)value);
+  fprintf(f, ",\n");
+}
+
+void mempool_timing_t::write_stats()
+{
+  FILE* f = fopen(stats_path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot open %s\n", stats_path);
+    return;
+  }
+
+  auto write = [f](const counters_t& c, const char* indent) {
+    write_counters(f, indent, "\"instructions\": %llu", c.instret);
+    write_counters(f, indent, "\"cycles\": %llu", c.cycles);
+    write_counters(f, indent, "\"loads\": %llu", c.loads);
+    write_counters(f, indent, "\"stores\": %llu", c.stores);
+    write_counters(f, indent, "\"local\": %llu", c.local);
+    write_counters(f, indent, "\"group\": %llu", c.group);
+    write_counters(f, indent, "\"remote\": %llu", c.remote);
+    write_counters(f, indent, "\"conflicts\": %llu", c.conflicts);
+    write_counters(f, indent, "\"latency_stalls\": %llu", c.latency_stalls);
+    write_counters(f, indent, "\"conflict_stalls\": %llu", c.conflict_stalls);
+    write_counters(f, indent, "\"fetch_stalls\": %llu", c.fetch_stalls);
+  };
+
+  fprintf(f, "{\n  \"harts\": [\n");
+  for (size_t i = 0; i < harts.size(); i++) {
+    hart_t& h = harts[i];
+    fprintf(f, "    {\n      \"hart\": %zu,\n", i);
+    write(update(h), "      ");
+    write_counters(f, "      ", "\"idle\": %llu", h.idle);
+    fprintf(f, "      \"regions\": [");
+    for (size_t r = 0; r < h.regions.size(); r++) {
+      fprintf(f, "%s\n        {\n", r ? "," : "");
+      write(h.regions[r], "          ");
+      fprintf(f, "          \"region\": %zu\n        }", r);
+    }
+    fprintf(f, "%s]\n    }%s\n", h.regions.empty() ? "" : "\n      ",
+            i + 1 < harts.size() ? "," : "");
+  }
+  fprintf(f, "  ],\n  \"tiles\": [\n");
+  for (size_t i = 0; i < tiles.size(); i++) {
+    tile_t& t = tiles[i];
+    fprintf(f, "    {\n      \"tile\": %zu,\n", i);
+    write_counters(f, "      ", "\"l0_accesses\": %llu", t.l0_accesses);
+    write_counters(f, "      ", "\"l0_misses\": %llu", t.l0_misses);
+    write_counters(f, "      ", "\"l1_accesses\": %llu", t.l1_accesses);
+    write_counters(f, "      ", "\"l1_misses\": %llu", t.l1_misses);
+    fprintf(f, "      \"fetch_stalls\": %llu\n    }%s\n",
+            (unsigned long long)t.fetch_stalls, i + 1 < tiles.size() ? "," : "");
+  }
+  fprintf(f, "  ]\n}\n");
+  fclose(f);
+}
@@ -0,0 +1,166 @@
+// See LICENSE for license details.
+
+// Cycle-approximate timing model of MemPool's L1 (TCDM) and instruction
+// caches. Every hart has its own clock, which advances by one cycle per
+// retired instruction plus the stalls that the model charges to its fetches
+// and L1 accesses.
+//
+// The L1 accesses are mapped to their bank like in
+// hardware/src/address_scrambler.sv and pay the latency of the interconnect to
+// the bank's tile. A bank serves one access per cycle, so the accesses of
+// different harts to the same bank in the same cycle conflict and are
+// serialized.
+//
+// The fetches go through a small L0 cache per core and an L1 instruction cache
+// shared by the cores of a tile, with the geometry of the snitch_icache in
+// hardware/src/mempool_tile.sv. Refills from L2 are shared by all cores that
+// miss on the same line while it is in flight.
+//
+// The harts run in slices of thousands of instructions, so their clocks drift
+// apart. The occupancy of the banks is therefore kept for a window of cycles,
+// which is larger than the drift between harts. A hart does not retire
+// instructions while it sleeps, so when another hart wakes it up, its clock
+// catches up with the clock of the waker.
+
+#ifndef _RISCV_MEMPOOL_TIMING_H
+#define _RISCV_MEMPOOL_TIMING_H
+
+#include "cachesim.h"
+#include "decode.h"
+#include "memtracer.h"
+#include <memory>
+#include <vector>
+
+class mempool_t;
+class processor_t;
+class sim_t;
+class mempool_timing_t;
+
+#define MEMPOOL_CORES_PER_TILE 4
+#define MEMPOOL_BANKS_PER_TILE 16
+#define MEMPOOL_BANK_SIZE      1024
+
+// Latency of an access to the banks of the own tile, of another tile of the
+// own group, and of a tile in a remote group, in cycles
+#define MEMPOOL_LATENCY_LOCAL  1
+#define MEMPOOL_LATENCY_GROUP  3
+#define MEMPOOL_LATENCY_REMOTE 5
+
+// Instruction caches, like ICacheSizeByte, ICacheSets, and ICacheLineWidth of
+// hardware/src/mempool_pkg.sv with one cache per tile
+#define MEMPOOL_ICACHE_SIZE      (512 * MEMPOOL_CORES_PER_TILE)
+#define MEMPOOL_ICACHE_WAYS      (MEMPOOL_CORES_PER_TILE / 2)
+#define MEMPOOL_ICACHE_LINE_SIZE (8 * MEMPOOL_CORES_PER_TILE)
+#define MEMPOOL_ICACHE_L0_LINES  4
+// Latency of a fetch that misses in the L0 but hits in the L1, and of a refill
+// of the L1 from L2 through the AXI interconnect, in cycles
+#define MEMPOOL_ICACHE_L1_LATENCY     2
+#define MEMPOOL_ICACHE_REFILL_LATENCY 24
+
+// Forwards the fetches and L1 accesses of one hart to the model
+class mempool_timing_port_t : public memtracer_t {
+ public:
+  mempool_timing_port_t(mempool_timing_t* timing, size_t hart)
+    : timing(timing), hart(hart) {}
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type);
+  void trace(uint64_t addr, size_t bytes, access_type type);
+
+ private:
+  mempool_timing_t* timing;
+  size_t hart;
+};
+
+class mempool_timing_t {
+ public:
+  // Attaches the model to all harts of the simulation and to the wake-ups of
+  // the cluster. The statistics are printed at the end and, with a path,
+  // written to it for every hart and tile.
+  mempool_timing_t(sim_t* sim, mempool_t* mempool, reg_t l1_size,
+                   const char* stats_path);
+  ~mempool_timing_t();
+
+  bool interested_in_range(uint64_t begin, uint64_t end, access_type type);
+  void access(size_t hart, uint64_t addr, access_type type);
+  void fetch(size_t hart, uint64_t addr);
+
+ private:
+  // Counters of a hart, or of one of its regions
+  struct counters_t {
+    uint64_t instret = 0;
+    uint64_t cycles = 0;
+    uint64_t loads = 0;
+    uint64_t stores = 0;
+    uint64_t local = 0;
+    uint64_t group = 0;
+    uint64_t remote = 0;
+    uint64_t conflicts = 0;
+    uint64_t latency_stalls = 0;
+    uint64_t conflict_stalls = 0;
+    uint64_t fetch_stalls = 0;
+
+    counters_t operator-(const counters_t& start) const;
+  };
+
+  // Line of an instruction cache, which is valid from the cycle its refill
+  // completes
+  struct icache_line_t {
+    bool valid = false;
+    uint64_t line = 0;
+    uint64_t ready = 0;
+  };
+
+  struct tile_t {
+    std::vector<icache_line_t> icache;
+    lfsr_t lfsr;
+    uint64_t l0_accesses = 0;
+    uint64_t l0_misses = 0;
+    uint64_t l1_accesses = 0;
+    uint64_t l1_misses = 0;
+    uint64_t fetch_stalls = 0;
+  };
+
+  struct hart_t {
+    processor_t* proc;
+    std::unique_ptr<mempool_timing_port_t> port;
+    size_t tile;
+    icache_line_t l0[MEMPOOL_ICACHE_L0_LINES];
+    size_t l0_next = 0;
+    // Cycles spent asleep, which do not retire instructions
+    uint64_t idle = 0;
+    counters_t total;
+    // Regions between writes of the trace CSR
+    bool in_region = false;
+    counters_t region_start;
+    std::vector<counters_t> regions;
+  };
+
+  // The bank occupancy is kept for WINDOW_WORDS * 64 cycles, one bit each
+  static const size_t WINDOW_WORDS = 1024;
+
+  std::vector<hart_t> harts;
+  // Hart of the last fetch, which is the hart that runs
+  size_t running = 0;
+  mempool_t* mempool;
+  std::vector<tile_t> tiles;
+  reg_t l1_size;
+  size_t num_tiles;
+  size_t tiles_per_group;
+  const char* stats_path;
+  std::vector<uint64_t> busy;
+  // Cycle divided by 64 that the words of busy belong to
+  std::vector<uint64_t> busy_tag;
+
+  counters_t& update(hart_t& h);
+  uint64_t now(hart_t& h) { return update(h).cycles; }
+  void trace_written(size_t hart, reg_t val);
+  void woken_up(uint32_t core_id);
+  size_t map(reg_t addr, size_t* tile);
+  uint64_t arbitrate(size_t bank, uint64_t cycle);
+  icache_line_t* l0_lookup(hart_t& h, uint64_t line);
+  uint64_t l0_refill(hart_t& h, uint64_t line, uint64_t cycle);
+  uint64_t l1_lookup(tile_t& t, uint64_t line, uint64_t cycle);
+  void print_stats();
+  void write_stats();
+};
+
+#endif
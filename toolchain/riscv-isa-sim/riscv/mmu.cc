@@ -4,6 +4,8 @@
 #include "simif.h"
 #include "processor.h"
 
+std::atomic<uint32_t> mmu_t::reservation_sets[RESERVATION_SETS];
+
 mmu_t::mmu_t(simif_t* sim, processor_t* proc)
  : sim(sim), proc(proc),
   check_triggers_fetch(false),
@@ -11,6 +13,8 @@ mmu_t::mmu_t(simif_t* sim, processor_t* proc)
   check_triggers_store(false),
   matched_trigger(NULL)
 {
+  parallel = false;
+  block_cache = false;
   flush_tlb();
   yield_load_reservation();
 }
@@ -23,6 +27,91 @@ void mmu_t::flush_icache()
 {
   for (size_t i = 0; i < ICACHE_ENTRIES; i++)
     icache[i].tag = -1;
+  flush_blocks();
+}
+
+void mmu_t::set_block_cache(bool value)
+{
+  block_cache = value;
+  blocks.resize(value ? BLOCK_ENTRIES : 0);
+  flush_blocks();
+}
+
+void mmu_t::flush_blocks()
+{
+  // A block that is executing stops after the current instruction
+  for (auto& block : blocks) {
+    block.tag = -1;
+    block.len = 0;
+  }
+  code_pages.clear();
+}
+
+insn_block_t* mmu_t::refill_block(reg_t addr, insn_block_t* block)
+{
+  // The instructions are read from the host memory of the page, which the
+  // TLB only holds for memory without triggers. With a tracer, every fetch
+  // takes the instruction cache.
+  auto tlb_entry = translate_insn_addr(addr);
+  block->tag = addr;
+  block->len = 0;
+  reg_t vpn = addr >> PGSHIFT;
+  reg_t page = (tlb_entry.target_offset + addr) & ~reg_t(PGSIZE - 1);
+  if (tlb_insn_tag[vpn % TLB_ENTRIES] != vpn ||
+      tracer.interested_in_range(page, page + PGSIZE, FETCH))
+    return block;
+
+  reg_t end = (addr & ~reg_t(PGSIZE - 1)) + PGSIZE;
+  reg_t pc = addr;
+  while (block->len < MAX_BLOCK_INSNS) {
+    const char* host = tlb_entry.host_offset + pc;
+    int length = insn_length(from_le(*(const uint16_t*)host));
+    if (pc + length > end)
+      break;
+
+    // The upper halfword is sign-extended, like in refill_icache
+    insn_bits_t insn = (int16_t)from_le(*(const int16_t*)(host + length - 2));
+    for (int i = length - 4; i >= 0; i -= 2)
+      insn = (insn << 16) | from_le(*(const uint16_t*)(host + i));
+
+    block->insns[block->len].fetch = {proc->decode_insn(insn), insn};
+    block->insns[block->len].pc = pc;
+    block->len++;
+    pc += length;
+
+    // fence.i flushes the blocks, and must not continue in a stale one
+    bool fence_i = (insn & 0x707f) == 0x100f;
+    if (insn_is_control_flow(insn) || fence_i)
+      break;
+  }
+  if (!block->len)
+    return block;
+
+  // The stores to a new code page must leave the TLB
+  auto code = code_pages.find(page);
+  if (code == code_pages.end()) {
+    code = code_pages.insert(std::make_pair(page, std::bitset<PGSIZE / PC_ALIGN>())).first;
+    memset(tlb_store_tag, -1, sizeof(tlb_store_tag));
+  }
+  for (reg_t a = addr; a < pc; a += PC_ALIGN)
+    code->second.set((a % PGSIZE) / PC_ALIGN);
+  return block;
+}
+
+void mmu_t::check_code_store(reg_t paddr, reg_t len)
+{
+  if (likely(code_pages.empty()))
+    return;
+  auto code = code_pages.find(paddr & ~reg_t(PGSIZE - 1));
+  if (code == code_pages.end())
+    return;
+  reg_t offset = paddr % PGSIZE;
+  for (reg_t i = offset / PC_ALIGN; i * PC_ALIGN < std::min(offset + len, PGSIZE); i++) {
+    if (code->second[i]) {
+      flush_blocks();
+      return;
+    }
+  }
 }
 
 void mmu_t::flush_tlb()
@@ -172,7 +261,8 @@ void mmu_t::store_slow_path(reg_t addr, reg_t len, const uint8_t* bytes, uint32_
   }
 
   if (auto host_addr = sim->addr_to_mem(paddr)) {
-    memcpy(host_addr, bytes, len);
+    write_host(host_addr, bytes, len);
+    check_code_store(paddr, len);
     if (tracer.interested_in_range(paddr, paddr + PGSIZE, STORE))
       tracer.trace(paddr, len, STORE);
     else
@@ -199,7 +289,14 @@ tlb_entry_t mmu_t::refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_
       (check_triggers_store && type == STORE))
     expected_tag |= TLB_CHECK_TRIGGERS;
 
-  if (pmp_homogeneous(paddr & ~reg_t(PGSIZE - 1), PGSIZE)) {
+  // The loads and stores of pages with a tracer must take the slow path, also
+  // after the TLB is refilled for LR and SC
+  reg_t page = paddr & ~reg_t(PGSIZE - 1);
+  bool traced = type != FETCH && tracer.interested_in_range(page, page + PGSIZE, type);
+  // The stores to the code of blocks must flush them
+  if (type == STORE && code_pages.count(page))
+    traced = true;
+  if (pmp_homogeneous(page, PGSIZE) && !traced) {
     if (type == FETCH) tlb_insn_tag[idx] = expected_tag;
     else if (type == STORE) tlb_store_tag[idx] = expected_tag;
     else tlb_load_tag[idx] = expected_tag;
@@ -11,7 +11,10 @@
 #include "processor.h"
 #include "memtracer.h"
 #include "byteorder.h"
+#include <atomic>
+#include <bitset>
 #include <stdlib.h>
+#include <unordered_map>
 #include <vector>
 
 // virtual memory configuration
@@ -32,6 +35,20 @@ struct icache_entry_t {
   insn_fetch_t data;
 };
 
+// Basic block of straight-line code, which is decoded once and then
+// dispatched from this array. It ends at a control-flow instruction, a fence.i,
+// the end of its page, or after MAX_BLOCK_INSNS instructions.
+#define MAX_BLOCK_INSNS 16
+struct insn_block_t {
+  reg_t tag;
+  // Zero for code that cannot be cached, and for a flushed block
+  size_t len;
+  struct {
+    insn_fetch_t fetch;
+    reg_t pc;
+  } insns[MAX_BLOCK_INSNS];
+};
+
 struct tlb_entry_t {
   char* host_offset;
   reg_t target_offset;
@@ -84,7 +101,8 @@ public:
 # define READ_MEM(addr, size) ({})
 #else
 # define READ_MEM(addr, size) \
-  proc->state.log_mem_read.push_back(std::make_tuple(addr, 0, size));
+  if (unlikely(proc->get_log_commits_enabled())) \
+    proc->state.log_mem_read.push_back(std::make_tuple(addr, 0, size));
 #endif
 
 #define RISCV_XLATE_VIRT (1U << 0)
@@ -151,7 +169,8 @@ public:
 # define WRITE_MEM(addr, value, size) ({})
 #else
 # define WRITE_MEM(addr, val, size) \
-  proc->state.log_mem_write.push_back(std::make_tuple(addr, val, size));
+  if (unlikely(proc->get_log_commits_enabled())) \
+    proc->state.log_mem_write.push_back(std::make_tuple(addr, val, size));
 #endif
 
   // template for functions that store an aligned value to memory
@@ -165,7 +184,8 @@ public:
       size_t size = sizeof(type##_t); \
       if (likely(tlb_store_tag[vpn % TLB_ENTRIES] == vpn)) { \
         if (proc) WRITE_MEM(addr, val, size); \
-        *(type##_t*)(tlb_data[vpn % TLB_ENTRIES].host_offset + addr) = to_le(val); \
+        type##_t le_val = to_le(val); \
+        write_host(tlb_data[vpn % TLB_ENTRIES].host_offset + addr, &le_val, size); \
       } \
       else if (unlikely(tlb_store_tag[vpn % TLB_ENTRIES] == (vpn | TLB_CHECK_TRIGGERS))) { \
         if (!matched_trigger) { \
@@ -174,7 +194,8 @@ public:
             throw *matched_trigger; \
         } \
         if (proc) WRITE_MEM(addr, val, size); \
-        *(type##_t*)(tlb_data[vpn % TLB_ENTRIES].host_offset + addr) = to_le(val); \
+        type##_t le_val = to_le(val); \
+        write_host(tlb_data[vpn % TLB_ENTRIES].host_offset + addr, &le_val, size); \
       } \
       else { \
         type##_t le_val = to_le(val); \
@@ -193,6 +214,19 @@ public:
         throw trap_store_address_misaligned(addr, 0, 0); \
       try { \
         auto lhs = load_##type(addr); \
+        if (unlikely(parallel)) { \
+          /* Other harts may access the memory concurrently */ \
+          auto host = (type##_t*)host_store_addr(addr, sizeof(type##_t), f(lhs)); \
+          if (host) { \
+            auto& set = reservation_set(host); \
+            uint32_t version = lock_reservation_set(set); \
+            type##_t old = from_le(*host), val = f(old); \
+            *host = to_le(val); \
+            set.store(version + 2, std::memory_order_release); \
+            if (proc) WRITE_MEM(addr, val, sizeof(type##_t)); \
+            return old; \
+          } \
+        } \
         store_##type(addr, f(lhs)); \
         return lhs; \
       } catch (trap_load_page_fault& t) { \
@@ -235,22 +269,89 @@ public:
   store_func(uint32, guest_store, RISCV_XLATE_VIRT)
   store_func(uint64, guest_store, RISCV_XLATE_VIRT)
 
+  // template for functions that perform a load reserved
+  #define load_reserved_func(type) \
+    type##_t load_reserved_##type(reg_t addr) { \
+      auto res = load_##type(addr); \
+      char* host = acquire_load_reservation(addr); \
+      if (likely(!parallel)) \
+        return res; \
+      /* Read the version of the reservation set together with the value, \
+         such that any store of another hart in between fails the SC */ \
+      auto& set = reservation_set(host); \
+      while (true) { \
+        uint32_t version = set.load(std::memory_order_acquire); \
+        if (version & 1) \
+          continue; \
+        res = from_le(*(volatile type##_t*)host); \
+        std::atomic_thread_fence(std::memory_order_acquire); \
+        if (set.load(std::memory_order_relaxed) == version) { \
+          load_reservation_version = version; \
+          return res; \
+        } \
+      } \
+    }
+
+  // template for functions that perform a store conditional
+  #define store_conditional_func(type) \
+    bool store_conditional_##type(reg_t addr, type##_t val) { \
+      if (!check_load_reservation(addr, sizeof(type##_t))) \
+        return false; \
+      if (unlikely(parallel)) { \
+        /* Succeeds if no hart stored to the reservation set since the LR */ \
+        if (auto host = (type##_t*)host_store_addr(addr, sizeof(type##_t), val)) { \
+          auto& set = reservation_set(host); \
+          uint32_t version = load_reservation_version; \
+          if (!set.compare_exchange_strong(version, version + 1, \
+                std::memory_order_acquire, std::memory_order_relaxed)) \
+            return false; \
+          *host = to_le(val); \
+          set.store(version + 2, std::memory_order_release); \
+          if (proc) WRITE_MEM(addr, val, sizeof(type##_t)); \
+          return true; \
+        } \
+      } \
+      store_##type(addr, val); \
+      return true; \
+    }
+
   // perform an atomic memory operation at an aligned address
   amo_func(uint32)
   amo_func(uint64)
 
+  // perform a load reserved at an aligned address
+  load_reserved_func(int32)
+  load_reserved_func(int64)
+
+  // perform a store conditional at an aligned address
+  store_conditional_func(uint32)
+  store_conditional_func(uint64)
+
+  // Orders the memory accesses of harts that run on different host threads
+  inline void fence()
+  {
+    if (unlikely(parallel))
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+  }
+
+  // Harts of a parallel simulation run on several host threads, such that
+  // AMOs and LR/SC must be atomic on the host as well
+  void set_parallel(bool value) { parallel = value; }
+
   inline void yield_load_reservation()
   {
     load_reservation_address = (reg_t)-1;
   }
 
-  inline void acquire_load_reservation(reg_t vaddr)
+  inline char* acquire_load_reservation(reg_t vaddr)
   {
     reg_t paddr = translate(vaddr, 1, LOAD, 0);
-    if (auto host_addr = sim->addr_to_mem(paddr))
+    if (auto host_addr = sim->addr_to_mem(paddr)) {
       load_reservation_address = refill_tlb(vaddr, paddr, host_addr, LOAD).target_offset + vaddr;
-    else
+      return host_addr;
+    } else {
       throw trap_load_access_fault(vaddr, 0, 0); // disallow LR to I/O space
+    }
   }
 
   inline bool check_load_reservation(reg_t vaddr, size_t size)
@@ -319,6 +420,27 @@ public:
     return refill_icache(addr, &entry)->data;
   }
 
+  static const reg_t BLOCK_ENTRIES = 256;
+
+  inline size_t block_index(reg_t addr)
+  {
+    return (addr / PC_ALIGN) % BLOCK_ENTRIES;
+  }
+
+  // The block that starts at addr, or NULL if the block cache is disabled or
+  // the code cannot be cached, e.g., because a tracer sees every fetch
+  inline insn_block_t* access_block(reg_t addr)
+  {
+    if (unlikely(!block_cache))
+      return NULL;
+    insn_block_t* block = &blocks[block_index(addr)];
+    if (unlikely(block->tag != addr))
+      block = refill_block(addr, block);
+    return likely(block->len) ? block : NULL;
+  }
+
+  void set_block_cache(bool value);
+
   void flush_tlb();
   void flush_icache();
 
@@ -347,11 +469,62 @@ private:
   processor_t* proc;
   memtracer_list_t tracer;
   reg_t load_reservation_address;
+  uint32_t load_reservation_version;
+  bool parallel;
+
+  // In a parallel simulation, the memory is split into reservation sets of
+  // RESERVATION_GRANULE bytes, hashed onto a table shared by all harts. Their
+  // version is odd while a store, AMO, or SC writes to the set, and advances
+  // by two with every write. An SC only succeeds if the version of its set
+  // did not change since the LR.
+  static const size_t RESERVATION_GRANULE = 8;
+  static const size_t RESERVATION_SETS = 4096;
+  static std::atomic<uint32_t> reservation_sets[RESERVATION_SETS];
+
+  inline std::atomic<uint32_t>& reservation_set(const void* host_addr)
+  {
+    return reservation_sets[((uintptr_t)host_addr / RESERVATION_GRANULE) % RESERVATION_SETS];
+  }
+
+  // wait until no other hart writes to the set and lock it; returns the
+  // version before the lock
+  inline uint32_t lock_reservation_set(std::atomic<uint32_t>& set)
+  {
+    uint32_t version = set.load(std::memory_order_relaxed);
+    while ((version & 1) || !set.compare_exchange_weak(version, version + 1,
+             std::memory_order_acquire, std::memory_order_relaxed))
+      version = set.load(std::memory_order_relaxed);
+    return version;
+  }
+
+  // write an aligned store of at most RESERVATION_GRANULE bytes to memory,
+  // which fails the SCs of the other harts to the same reservation set
+  inline void write_host(char* host_addr, const void* bytes, size_t len)
+  {
+    if (likely(!parallel)) {
+      memcpy(host_addr, bytes, len);
+      return;
+    }
+    auto& set = reservation_set(host_addr);
+    uint32_t version = lock_reservation_set(set);
+    memcpy(host_addr, bytes, len);
+    set.store(version + 2, std::memory_order_release);
+  }
   uint16_t fetch_temp;
 
   // implement an instruction cache for simulator performance
   icache_entry_t icache[ICACHE_ENTRIES];
 
+  // Basic blocks, and the halfwords of their code per physical page. The
+  // stores to these pages take the slow path, which flushes the blocks if
+  // their code is overwritten.
+  bool block_cache;
+  std::vector<insn_block_t> blocks;
+  std::unordered_map<reg_t, std::bitset<PGSIZE / PC_ALIGN>> code_pages;
+  insn_block_t* refill_block(reg_t addr, insn_block_t* block);
+  void flush_blocks();
+  void check_code_store(reg_t paddr, reg_t len);
+
   // implement a TLB for simulator performance
   static const reg_t TLB_ENTRIES = 256;
   // If a TLB tag has TLB_CHECK_TRIGGERS set, then the MMU must check for a
@@ -362,6 +535,31 @@ private:
   reg_t tlb_load_tag[TLB_ENTRIES];
   reg_t tlb_store_tag[TLB_ENTRIES];
 
+  // host address of an aligned store of |val| to memory, or NULL for I/O
+  // space. Like store_slow_path, checks the store triggers and reports the
+  // store to the memory tracers, but leaves the write to the caller.
+  inline char* host_store_addr(reg_t vaddr, size_t size, reg_t val)
+  {
+    reg_t vpn = vaddr >> PGSHIFT;
+    if (likely(tlb_store_tag[vpn % TLB_ENTRIES] == vpn))
+      return tlb_data[vpn % TLB_ENTRIES].host_offset + vaddr;
+    reg_t paddr = translate(vaddr, size, STORE, 0);
+    if (!matched_trigger) {
+      matched_trigger = trigger_exception(OPERATION_STORE, vaddr, val);
+      if (matched_trigger)
+        throw *matched_trigger;
+    }
+    if (auto host_addr = sim->addr_to_mem(paddr)) {
+      check_code_store(paddr, size);
+      if (tracer.interested_in_range(paddr, paddr + PGSIZE, STORE))
+        tracer.trace(paddr, size, STORE);
+      else
+        refill_tlb(vaddr, paddr, host_addr, STORE);
+      return host_addr;
+    }
+    return NULL;
+  }
+
   // finish translation on a TLB miss and update the TLB
   tlb_entry_t refill_tlb(reg_t vaddr, reg_t paddr, char* host_addr, access_type type);
   const char* fill_from_mmio(reg_t vaddr, reg_t paddr);
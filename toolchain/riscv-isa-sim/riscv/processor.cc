@@ -26,10 +26,12 @@ processor_t::processor_t(const char* isa, const char* priv, const char* varch,
                          FILE* log_file)
   : debug(false), halt_request(HR_NONE), sim(sim), ext(NULL), id(id), xlen(0),
   histogram_enabled(false), log_commits_enabled(false),
-  log_file(log_file), halt_on_reset(halt_on_reset),
-  extension_table(256, false), last_pc(1), executions(1)
+  log_file(log_file), commit_log(NULL), halt_on_reset(halt_on_reset),
+  reset_pc(DEFAULT_RSTVEC), wfi_parking(false), parked(false),
+  wake_up_pending(false), step_instret(0), extension_table(256, false), last_pc(1), executions(1)
 {
   VU.p = this;
+  histogram_base = 0;
 
   parse_isa_string(isa);
   parse_priv_string(priv);
@@ -50,15 +52,9 @@ processor_t::processor_t(const char* isa, const char* priv, const char* varch,
 
 processor_t::~processor_t()
 {
-#ifdef RISCV_ENABLE_HISTOGRAM
-  if (histogram_enabled)
-  {
-    fprintf(stderr, "PC Histogram size:%zu\n", pc_histogram.size());
-    for (auto it : pc_histogram)
-      fprintf(stderr, "%0" PRIx64 " %" PRIu64 "\n", it.first, it.second);
-  }
+#ifdef RISCV_ENABLE_COMMITLOG
+  flush_commit_log();
 #endif
-
   delete mmu;
   delete disassembler;
 }
@@ -306,6 +302,7 @@ void state_t::reset(reg_t max_isa)
   mtval = 0;
   mscratch = 0;
   mtvec = 0;
+  trace = 0;
   mcause = 0;
   minstret = 0;
   mie = 0;
@@ -438,16 +435,49 @@ void processor_t::set_histogram(bool value)
 #endif
 }
 
+void processor_t::set_histogram_range(reg_t base, reg_t end)
+{
+  // The PCs of RV32 harts are sign-extended
+  histogram_base = max_xlen == 32 ? reg_t(int32_t(base)) : base;
+  pc_counts.assign((end - base + 1) / 2, 0);
+}
+
+std::map<reg_t, uint64_t> processor_t::get_histogram()
+{
+  // Returns the PCs as addresses, without the sign extension of RV32
+  reg_t mask = max_xlen == 32 ? 0xffffffff : reg_t(-1);
+  std::map<reg_t, uint64_t> histogram;
+  for (auto it : pc_histogram)
+    histogram[it.first & mask] += it.second;
+  for (size_t i = 0; i < pc_counts.size(); i++)
+    if (pc_counts[i])
+      histogram[(histogram_base + 2 * i) & mask] = pc_counts[i];
+  return histogram;
+}
+
 #ifdef RISCV_ENABLE_COMMITLOG
-void processor_t::enable_log_commits()
+void processor_t::enable_log_commits(commit_log_writer_t* writer)
 {
   log_commits_enabled = true;
+  commit_log = writer;
+  if (commit_log)
+    commit_log_buffer.reserve(COMMIT_LOG_BLOCK_RECORDS);
+}
+
+void processor_t::flush_commit_log()
+{
+  if (commit_log)
+    commit_log->write(id, commit_log_buffer.data(), commit_log_buffer.size());
+  commit_log_buffer.clear();
 }
 #endif
 
 void processor_t::reset()
 {
   state.reset(max_isa);
+  state.pc = reset_pc;
+  parked = false;
+  wake_up_pending = false;
 
   state.mideleg = supports_extension('H') ? MIDELEG_FORCED_MASK : 0;
 
@@ -776,7 +806,8 @@ void processor_t::set_csr(int which, reg_t val)
 {
 #if defined(RISCV_ENABLE_COMMITLOG)
 #define LOG_CSR(rd) \
-  STATE.log_reg_write[((which) << 4) | 4] = {get_csr(rd), 0};
+  if (log_commits_enabled) \
+    STATE.log_reg_write[((which) << 4) | 4] = {get_csr(rd), 0};
 #else
 #define LOG_CSR(rd)
 #endif
@@ -1017,6 +1048,11 @@ void processor_t::set_csr(int which, reg_t val)
     case CSR_MEPC: state.mepc = val & ~(reg_t)1; break;
     case CSR_MTVEC: state.mtvec = val & ~(reg_t)2; break;
     case CSR_MSCRATCH: state.mscratch = val; break;
+    case CSR_TRACE:
+      state.trace = val;
+      if (trace_callback)
+        trace_callback(val);
+      break;
     case CSR_MCAUSE: state.mcause = val; break;
     case CSR_MTVAL: state.mtval = val; break;
     case CSR_MTVAL2: state.mtval2 = val; break;
@@ -1289,6 +1325,7 @@ void processor_t::set_csr(int which, reg_t val)
     case CSR_MEPC:
     case CSR_MTVEC:
     case CSR_MSCRATCH:
+    case CSR_TRACE:
     case CSR_MCAUSE:
     case CSR_MTVAL:
     case CSR_MISA:
@@ -1493,6 +1530,7 @@ reg_t processor_t::get_csr(int which, insn_t insn, bool write, bool peek)
     case CSR_MIE: ret(state.mie);
     case CSR_MEPC: ret(state.mepc & pc_alignment_mask());
     case CSR_MSCRATCH: ret(state.mscratch);
+    case CSR_TRACE: ret(state.trace);
     case CSR_MCAUSE: ret(state.mcause);
     case CSR_MTVAL: ret(state.mtval);
     case CSR_MTVAL2:
@@ -1813,3 +1851,11 @@ void processor_t::trigger_updated()
     }
   }
 }
+
+void processor_t::wake_up()
+{
+  if (parked)
+    parked = false;
+  else
+    wake_up_pending = true;
+}
@@ -6,10 +6,12 @@
 #include "config.h"
 #include "devices.h"
 #include "trap.h"
+#include "commit_log.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <functional>
 #include <cassert>
 #include "debug_rom_defines.h"
 
@@ -167,6 +169,7 @@ struct state_t
   reg_t mtval;
   reg_t mscratch;
   reg_t mtvec;
+  reg_t trace;
   reg_t mcause;
   reg_t minstret;
   reg_t mie;
@@ -265,11 +268,31 @@ public:
 
   void set_debug(bool value);
   void set_histogram(bool value);
+  // Counts the PCs of [base, end) in a dense array and all others in a hash
+  // map. The range should cover the text of the program, and is set before
+  // the hart runs.
+  void set_histogram_range(reg_t base, reg_t end);
+  // Retired instructions per PC
+  std::map<reg_t, uint64_t> get_histogram();
 #ifdef RISCV_ENABLE_COMMITLOG
-  void enable_log_commits();
+  // With a writer, the commits are recorded in the binary format of
+  // commit_log.h instead of being printed to the log file.
+  void enable_log_commits(commit_log_writer_t* writer = NULL);
   bool get_log_commits_enabled() const { return log_commits_enabled; }
+  commit_log_writer_t* get_commit_log() const { return commit_log; }
+  // Zeroed record at the end of the buffer, which is written to the log
+  // when it is full
+  commit_log_record_t* next_commit_record()
+  {
+    if (commit_log_buffer.size() == COMMIT_LOG_BLOCK_RECORDS)
+      flush_commit_log();
+    commit_log_buffer.emplace_back();
+    return &commit_log_buffer.back();
+  }
+  void flush_commit_log();
 #endif
   void reset();
+  void set_reset_pc(reg_t pc) { reset_pc = pc; state.pc = pc; }
   void step(size_t n); // run for n cycles
   void set_csr(int which, reg_t val);
   reg_t get_csr(int which, insn_t insn, bool write, bool peek = 0);
@@ -411,6 +434,29 @@ public:
 
   const char* get_symbol(uint64_t addr);
 
+  // When WFI parking is enabled, a WFI does not wait for an interrupt but
+  // parks the hart until it receives a wake-up, like the Snitch cores in
+  // MemPool. A wake-up that arrives while the hart runs is latched and lets
+  // its next WFI fall through.
+  void set_wfi_parking(bool value) { wfi_parking = value; }
+  void wake_up();
+  // Whether the hart sleeps in a WFI. Harts that enable interrupts sleep
+  // until one of them is pending, parked harts until they are woken up.
+  bool is_sleeping()
+  {
+    if (parked && ((state.mip & state.mie) || halt_request != HR_NONE))
+      parked = false;
+    return parked;
+  }
+  // Instructions retired so far, including those of the current step()
+  reg_t get_instret() { return state.minstret + step_instret; }
+  // Called with the new value whenever the trace CSR is written, such that
+  // timing models can delimit the regions of a benchmark
+  void set_trace_callback(std::function<void(reg_t)> callback)
+  {
+    trace_callback = callback;
+  }
+
 private:
   simif_t* sim;
   mmu_t* mmu; // main memory is always accessed via the mmu
@@ -425,12 +471,22 @@ private:
   bool histogram_enabled;
   bool log_commits_enabled;
   FILE *log_file;
+  commit_log_writer_t* commit_log;
+  std::vector<commit_log_record_t> commit_log_buffer;
   bool halt_on_reset;
+  reg_t reset_pc;
+  bool wfi_parking;
+  bool parked;
+  bool wake_up_pending;
+  size_t step_instret;
+  std::function<void(reg_t)> trace_callback;
   std::vector<bool> extension_table;
   
 
   std::vector<insn_desc_t> instructions;
-  std::map<reg_t,uint64_t> pc_histogram;
+  reg_t histogram_base;
+  std::vector<uint64_t> pc_counts;
+  std::unordered_map<reg_t, uint64_t> pc_histogram;
 
   static const size_t OPCODE_CACHE_SIZE = 8191;
   insn_desc_t opcode_cache[OPCODE_CACHE_SIZE];
@@ -493,7 +549,7 @@ public:
           reg_referenced[vReg] = 1;
 
 #ifdef RISCV_ENABLE_COMMITLOG
-          if (is_write)
+          if (is_write && p->get_log_commits_enabled())
             p->get_state()->log_reg_write[((vReg) << 4) | 2] = {0, 0};
 #endif
 
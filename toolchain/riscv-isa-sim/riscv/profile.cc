@@ -0,0 +1,126 @@
+// See LICENSE for license details.
+
+// Profile of the PC histogram (-g). The retired instructions are attributed to
+// the function of the closest symbol below the PC and to the basic blocks
+// within it. A summary per function of all harts is printed to stderr, and
+// the basic blocks of every hart are written as folded stacks, which
+// flamegraph.pl, speedscope, and similar tools read:
+//
+//   hart_0;matmul;matmul+0x1c 12800
+
+#include "sim.h"
+#include "byteorder.h"
+#include "decode.h"
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct block_t {
+  std::string function;
+  reg_t offset;
+  uint64_t instructions;
+};
+
+}
+
+void sim_t::report_profile()
+{
+  const std::map<uint64_t, std::string>& symbols = get_symbols();
+  auto in_text = [&](reg_t pc) {
+    for (auto& segment : get_text_segments())
+      if (pc >= segment.first && pc < segment.second)
+        return true;
+    return false;
+  };
+
+  // Splits a histogram into basic blocks. A block ends at a control-flow
+  // instruction, a gap, or a change of the count, which marks a branch target.
+  auto split = [&](const std::map<reg_t, uint64_t>& histogram) {
+    std::vector<block_t> blocks;
+    reg_t next_pc = 0;
+    uint64_t count = 0;
+    bool ends = true;
+    for (auto& it : histogram) {
+      reg_t pc = it.first;
+      // Outside of the program, e.g., in the boot ROM, the PCs have no symbol
+      auto symbol = symbols.upper_bound(pc);
+      bool has_symbol = symbol != symbols.begin() && in_text(pc);
+      if (has_symbol)
+        --symbol;
+
+      if (ends || pc != next_pc || it.second != count ||
+          (has_symbol && symbol->first == pc)) {
+        block_t block;
+        block.function = has_symbol ? symbol->second : "[unknown]";
+        // Without a symbol, the offset is the address
+        block.offset = has_symbol ? pc - symbol->first : pc;
+        block.instructions = 0;
+        blocks.push_back(block);
+      }
+      blocks.back().instructions += it.second;
+
+      insn_bits_t insn = 0;
+      if (char* host = addr_to_mem(pc))
+        insn = from_le(*(uint16_t*)host);
+      if (insn_length(insn) == 4) {
+        if (char* host = addr_to_mem(pc + 2))
+          insn |= insn_bits_t(from_le(*(uint16_t*)host)) << 16;
+      }
+      next_pc = pc + insn_length(insn);
+      ends = insn_is_control_flow(insn);
+      count = it.second;
+    }
+    return blocks;
+  };
+
+  std::map<reg_t, uint64_t> total;
+  std::vector<std::map<reg_t, uint64_t>> histograms;
+  for (processor_t* proc : procs) {
+    histograms.push_back(proc->get_histogram());
+    for (auto& it : histograms.back())
+      total[it.first] += it.second;
+  }
+
+  // Summary of all harts per function
+  std::map<std::string, uint64_t> functions;
+  uint64_t instructions = 0;
+  for (const block_t& block : split(total)) {
+    functions[block.function] += block.instructions;
+    instructions += block.instructions;
+  }
+  std::vector<std::pair<uint64_t, std::string>> sorted;
+  for (auto& it : functions)
+    sorted.push_back(std::make_pair(it.second, it.first));
+  std::sort(sorted.rbegin(), sorted.rend());
+
+  fprintf(stderr, "# Instructions of %zu harts per function\n#\n", procs.size());
+  fprintf(stderr, "# Overhead  Instructions  Function\n");
+  for (auto& it : sorted) {
+    fprintf(stderr, "  %7.2f%%  %12" PRIu64 "  %s\n",
+            100.0 * it.first / std::max<uint64_t>(instructions, 1), it.first,
+            it.second.c_str());
+  }
+
+  if (!profile_path)
+    return;
+  FILE* f = fopen(profile_path, "w");
+  if (!f) {
+    fprintf(stderr, "Cannot open %s\n", profile_path);
+    return;
+  }
+  for (size_t i = 0; i < procs.size(); i++) {
+    for (const block_t& block : split(histograms[i])) {
+      if (block.function == "[unknown]")
+        fprintf(f, "hart_%zu;[unknown];0x%" PRIx64, i, block.offset);
+      else
+        fprintf(f, "hart_%zu;%s;%s+0x%" PRIx64, i, block.function.c_str(),
+                block.function.c_str(), block.offset);
+      fprintf(f, " %" PRIu64 "\n", block.instructions);
+    }
+  }
+  fclose(f);
+}
@@ -51,8 +51,14 @@ sim_t::sim_t(const char* isa, const char* priv, const char* varch,
     current_proc(0),
     debug(false),
     histogram_enabled(false),
+    profile_path(NULL),
     log(false),
     remote_bitbang(NULL),
+    quantum(0),
+    shards_done(0),
+    workers_exit(false),
+    parallel(false),
+    quantum_running(false),
     debug_module(this, dm_config)
 {
   signal(SIGINT, &handle_signal);
@@ -103,6 +109,14 @@ sim_t::sim_t(const char* isa, const char* priv, const char* varch,
 
 sim_t::~sim_t()
 {
+  {
+    std::lock_guard<std::mutex> lock(quantum_mutex);
+    workers_exit = true;
+  }
+  quantum_start.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+
   for (size_t i = 0; i < procs.size(); i++)
     delete procs[i];
   delete debug_mmu;
@@ -122,6 +136,8 @@ void sim_t::main()
   {
     if (debug || ctrlc_pressed)
       interactive();
+    else if (parallel)
+      step_parallel();
     else
       step(INTERLEAVE);
     if (remote_bitbang) {
@@ -134,22 +150,52 @@ int sim_t::run()
 {
   host = context_t::current();
   target.init(sim_thread_main, this);
-  return htif_t::run();
+  int exit_code = htif_t::run();
+  if (histogram_enabled)
+    report_profile();
+  return exit_code;
+}
+
+bool sim_t::schedule()
+{
+  active_procs.clear();
+  for (size_t i = 0; i < procs.size(); i++)
+    if (!procs[i]->is_sleeping())
+      active_procs.push_back(procs[i]);
+  if (!active_procs.empty())
+    return true;
+
+  // All harts sleep, skip ahead to the next timer interrupt
+  if (reg_t ticks = clint->time_to_next_timer()) {
+    clint->increment(ticks);
+  } else if (clint->is_real_time()) {
+    clint->increment(0);
+  } else if (!remote_bitbang) {
+    std::cerr << "All harts sleep without an interrupt to wake them up" << std::endl;
+    request_exit(-1);
+  }
+  return false;
 }
 
 void sim_t::step(size_t n)
 {
   for (size_t i = 0, steps = 0; i < n; i += steps)
   {
+    if (current_proc == 0 && current_step == 0 && !schedule()) {
+      steps = n - i;
+      host->switch_to();
+      continue;
+    }
+
     steps = std::min(n - i, INTERLEAVE - current_step);
-    procs[current_proc]->step(steps);
+    active_procs[current_proc]->step(steps);
 
     current_step += steps;
     if (current_step == INTERLEAVE)
     {
       current_step = 0;
-      procs[current_proc]->get_mmu()->yield_load_reservation();
-      if (++current_proc == procs.size()) {
+      active_procs[current_proc]->get_mmu()->yield_load_reservation();
+      if (++current_proc == active_procs.size()) {
         current_proc = 0;
         clint->increment(INTERLEAVE / INSNS_PER_RTC_TICK);
       }
@@ -159,6 +205,79 @@ void sim_t::step(size_t n)
   }
 }
 
+void sim_t::set_threads(size_t n)
+{
+  n = std::min(n, procs.size());
+  parallel = n > 1;
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->set_parallel(parallel);
+  for (size_t shard = 1; shard < n; shard++)
+    workers.emplace_back(&sim_t::worker_main, this, shard);
+}
+
+void sim_t::run_shard(size_t shard)
+{
+  size_t nshards = workers.size() + 1;
+  size_t begin = shard * active_procs.size() / nshards;
+  size_t end = (shard + 1) * active_procs.size() / nshards;
+  for (size_t i = begin; i < end; i++)
+    active_procs[i]->step(INTERLEAVE);
+}
+
+void sim_t::worker_main(size_t shard)
+{
+  uint64_t last_quantum = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(quantum_mutex);
+      quantum_start.wait(lock, [&]{ return workers_exit || quantum != last_quantum; });
+      if (workers_exit)
+        return;
+      last_quantum = quantum;
+    }
+    run_shard(shard);
+    {
+      std::lock_guard<std::mutex> lock(quantum_mutex);
+      shards_done++;
+    }
+    quantum_done.notify_one();
+  }
+}
+
+void sim_t::step_parallel()
+{
+  // Only the harts that do not sleep are spread over the threads
+  if (!schedule()) {
+    host->switch_to();
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(quantum_mutex);
+    quantum++;
+    shards_done = 0;
+    quantum_running = true;
+  }
+  quantum_start.notify_all();
+  run_shard(0);
+  {
+    std::unique_lock<std::mutex> lock(quantum_mutex);
+    quantum_done.wait(lock, [&]{ return shards_done == workers.size(); });
+    quantum_running = false;
+  }
+
+  // The devices are updated at the end of the quantum, when the harts of
+  // all threads stand still
+  for (auto& store : posted_stores)
+    bus.store(store.first, store.second.size(), store.second.data());
+  posted_stores.clear();
+  for (size_t i = 0; i < procs.size(); i++)
+    procs[i]->get_mmu()->yield_load_reservation();
+  clint->increment(INTERLEAVE / INSNS_PER_RTC_TICK);
+
+  host->switch_to();
+}
+
 void sim_t::set_debug(bool value)
 {
   debug = value;
@@ -172,7 +291,8 @@ void sim_t::set_histogram(bool value)
   }
 }
 
-void sim_t::configure_log(bool enable_log, bool enable_commitlog)
+void sim_t::configure_log(bool enable_log, bool enable_commitlog,
+                          const char* commitlog_path)
 {
   log = enable_log;
 
@@ -186,8 +306,10 @@ void sim_t::configure_log(bool enable_log, bool enable_commitlog)
         stderr);
   abort();
 #else
+  if (commitlog_path)
+    commit_log.reset(new commit_log_writer_t(commitlog_path));
   for (processor_t *proc : procs) {
-    proc->enable_log_commits();
+    proc->enable_log_commits(commit_log.get());
   }
 #endif
 }
@@ -207,6 +329,10 @@ bool sim_t::mmio_load(reg_t addr, size_t len, uint8_t* bytes)
 {
   if (addr + len < addr || !paddr_ok(addr + len - 1))
     return false;
+  if (quantum_running) {
+    std::lock_guard<std::mutex> lock(mmio_mutex);
+    return bus.load(addr, len, bytes);
+  }
   return bus.load(addr, len, bytes);
 }
 
@@ -214,6 +340,14 @@ bool sim_t::mmio_store(reg_t addr, size_t len, const uint8_t* bytes)
 {
   if (addr + len < addr || !paddr_ok(addr + len - 1))
     return false;
+  if (quantum_running) {
+    // Posted until the end of the quantum
+    if (!bus.find_device(addr).second)
+      return false;
+    std::lock_guard<std::mutex> lock(mmio_mutex);
+    posted_stores.emplace_back(addr, std::vector<uint8_t>(bytes, bytes + len));
+    return true;
+  }
   return bus.store(addr, len, bytes);
 }
 
@@ -294,6 +428,26 @@ char* sim_t::addr_to_mem(reg_t addr) {
   return NULL;
 }
 
+void sim_t::load_program()
+{
+  htif_t::load_program();
+
+  // Count the PCs of the text in dense arrays. Text segments that are far
+  // apart fall back to the hash maps.
+  auto& text = get_text_segments();
+  if (!histogram_enabled || text.empty())
+    return;
+  reg_t base = text[0].first, end = text[0].second;
+  for (auto& segment : text) {
+    if (std::max(end, segment.second) - std::min(base, segment.first) <= MAX_HISTOGRAM_RANGE) {
+      base = std::min(base, segment.first);
+      end = std::max(end, segment.second);
+    }
+  }
+  for (processor_t* proc : procs)
+    proc->set_histogram_range(base, std::min(end, base + MAX_HISTOGRAM_RANGE));
+}
+
 const char* sim_t::get_symbol(uint64_t addr)
 {
   return htif_t::get_symbol(addr);
@@ -14,6 +14,9 @@
 #include <vector>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
 #include <sys/types.h>
 
 class mmu_t;
@@ -37,22 +40,33 @@ public:
   int run();
   void set_debug(bool value);
   void set_histogram(bool value);
+  // Write the profile of the PC histogram as folded stacks to path
+  void set_profile(const char* path) { profile_path = path; }
 
   // Configure logging
   //
   // If enable_log is true, an instruction trace will be generated. If
   // enable_commitlog is true, so will the commit results (if this
   // build was configured without support for commit logging, the
-  // function will print an error message and abort).
-  void configure_log(bool enable_log, bool enable_commitlog);
+  // function will print an error message and abort). With a
+  // commitlog_path, the commit results are written to it in the binary
+  // format of commit_log.h.
+  void configure_log(bool enable_log, bool enable_commitlog,
+                     const char* commitlog_path = NULL);
 
   void set_procs_debug(bool value);
+  // Shard the harts across the given number of host threads. The harts then
+  // run in parallel for a quantum of INTERLEAVE instructions each, and the
+  // stores to devices take effect at the end of the quantum.
+  void set_threads(size_t n);
   void set_remote_bitbang(remote_bitbang_t* remote_bitbang) {
     this->remote_bitbang = remote_bitbang;
   }
   const char* get_dts() { if (dts.empty()) reset(); return dts.c_str(); }
   processor_t* get_core(size_t i) { return procs.at(i); }
   unsigned nprocs() const { return procs.size(); }
+  // Attach a device of a platform model to the system bus
+  void add_device(reg_t addr, abstract_device_t* dev) { bus.add_device(addr, dev); }
 
   // Callback for processors to let the simulation know they were reset.
   void proc_reset(unsigned id);
@@ -74,19 +88,41 @@ private:
   std::unique_ptr<clint_t> clint;
   bus_t bus;
   log_file_t log_file;
+  // Outlives procs, which flush their records when they are deleted
+  std::unique_ptr<commit_log_writer_t> commit_log;
 
   processor_t* get_core(const std::string& i);
   void step(size_t n); // step through simulation
+  bool schedule(); // collect the harts that do not sleep
+  void step_parallel(); // run one quantum on all host threads
+  void run_shard(size_t shard);
+  void worker_main(size_t shard);
   static const size_t INTERLEAVE = 5000;
   static const size_t INSNS_PER_RTC_TICK = 100; // 10 MHz clock for 1 BIPS core
   static const size_t CPU_HZ = 1000000000; // 1GHz CPU
+  static const reg_t MAX_HISTOGRAM_RANGE = 256 << 10; // bytes of text per hart
   size_t current_step;
   size_t current_proc;
+  std::vector<processor_t*> active_procs;
   bool debug;
   bool histogram_enabled; // provide a histogram of PCs
+  const char* profile_path;
   bool log;
   remote_bitbang_t* remote_bitbang;
 
+  // parallel simulation
+  std::vector<std::thread> workers;
+  std::mutex quantum_mutex;
+  std::condition_variable quantum_start;
+  std::condition_variable quantum_done;
+  uint64_t quantum;
+  size_t shards_done;
+  bool workers_exit;
+  bool parallel;
+  bool quantum_running;
+  std::mutex mmio_mutex;
+  std::vector<std::pair<reg_t, std::vector<uint8_t>>> posted_stores;
+
   // memory-mapped I/O routines
   char* addr_to_mem(reg_t addr);
   bool mmio_load(reg_t addr, size_t len, uint8_t* bytes);
@@ -95,6 +131,9 @@ private:
   void set_rom();
 
   const char* get_symbol(uint64_t addr);
+  void load_program();
+  // Report the instructions per function and basic block, see profile.cc
+  void report_profile();
 
   // presents a prompt for introspection into the simulation
   void interactive();
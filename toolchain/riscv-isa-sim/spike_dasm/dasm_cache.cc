@@ -0,0 +1,58 @@
+// See LICENSE for license details.
+
+#include "dasm_cache.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+static const char DASM[] = "DASM(";
+
+void disassemble_line(const char* begin, const char* end, std::string& out,
+                      dasm_cache_t& dasm)
+{
+  const size_t len = strlen(DASM);
+  const char* copied = begin;
+  for (const char* pos = begin; end - pos >= (ptrdiff_t)len; ) {
+    pos = (const char*)memchr(pos, 'D', end - pos - len + 1);
+    if (!pos)
+      break;
+    if (memcmp(pos, DASM, len) != 0) {
+      pos++;
+      continue;
+    }
+
+    const char* start = pos;
+    pos += len;
+
+    if (end - pos >= 2 && pos[0] == '0' && (pos[1] == 'x' || pos[1] == 'X'))
+      pos += 2;
+
+    // The hex number ends at the closing parenthesis, within 16 digits
+    const char* hex = pos;
+    int64_t bits = 0;
+    while (pos < end && pos - hex < 16 && isxdigit(*pos)) {
+      bits = (bits << 4) | (isdigit(*pos) ? *pos - '0' : (tolower(*pos) - 'a' + 10));
+      pos++;
+    }
+    if (pos == hex || pos == end || *pos != ')')
+      continue;
+
+    size_t nbits = 4 * (pos - hex);
+    if (nbits < 64)
+      bits = bits << (64 - nbits) >> (64 - nbits);
+
+    out.append(copied, start);
+    out += dasm.disassemble(bits);
+    copied = ++pos;
+  }
+  out.append(copied, end);
+}
+
+void disassemble_line(std::string& s, dasm_cache_t& dasm)
+{
+  if (s.find(DASM) == std::string::npos)
+    return;
+  std::string out;
+  disassemble_line(s.data(), s.data() + s.size(), out, dasm);
+  s.swap(out);
+}
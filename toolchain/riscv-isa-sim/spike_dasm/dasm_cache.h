@@ -0,0 +1,43 @@
+// See LICENSE for license details.
+
+// Disassembly of the DASM(hex) placeholders in instruction traces, which is
+// shared by spike-dasm and mempool-trace.
+
+#ifndef _DASM_CACHE_H
+#define _DASM_CACHE_H
+
+#include "disasm.h"
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+// Disassembles instructions, remembering the few that make up most of a trace.
+// The disassembler may be shared by the caches of several threads.
+class dasm_cache_t
+{
+ public:
+  dasm_cache_t(const disassembler_t& disassembler)
+    : disassembler(disassembler) {}
+
+  const std::string& disassemble(int64_t bits)
+  {
+    auto it = cache.find(bits);
+    if (it == cache.end())
+      it = cache.emplace(bits, disassembler.disassemble(bits)).first;
+    return it->second;
+  }
+
+ private:
+  const disassembler_t& disassembler;
+  std::unordered_map<int64_t, std::string> cache;
+};
+
+// Appends the line [begin, end) to out, with all occurrences of DASM(hex)
+// replaced by their disassembly
+void disassemble_line(const char* begin, const char* end, std::string& out,
+                      dasm_cache_t& dasm);
+
+// Same for a whole string, in place
+void disassemble_line(std::string& s, dasm_cache_t& dasm);
+
+#endif
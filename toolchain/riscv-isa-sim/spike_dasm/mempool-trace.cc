@@ -0,0 +1,1090 @@
+// See LICENSE for license details.
+
+// This program turns the instruction traces of the MemPool Snitch cores
+// (trace_hart_XXXX.dasm, or trace_hart_XXXX.bin in the binary format of
+// snitch_trace.h) into annotated, human-readable traces and computes
+// performance metrics for every benchmark section. It combines what used to
+// be done by running spike-dasm and scripts/gen_trace.py once per hart, but
+// takes the traces of all harts in one invocation and processes them in
+// parallel. The output of every hart is written to trace_hart_XXXX.trace and
+// the metrics of all harts are appended to a CSV file.
+
+#include "dasm_cache.h"
+#include "disasm.h"
+#include "extension.h"
+#include "snitch_trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <fesvr/option_parser.h>
+using namespace std;
+
+// Below this absolute value: use signed int representation. Above:
+// unsigned 32-bit hex
+static const int64_t MAX_SIGNED_INT_LIT = 0xFFFF;
+
+static const char* const REG_ABI_NAMES_I[] = {
+  "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+  "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+  "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+  "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6"
+};
+
+static const char* const LS_SIZES[] = {"Byte", "Half", "Word", "Doub"};
+
+enum { OPER_GPR = 1, OPER_CSR = 8 };
+
+enum { SRC_SNITCH = 0, SRC_FPU = 1, SRC_SEQUENCER = 2 };
+
+enum { REGION_OTHER = 0, REGION_SEQUENTIAL = 1, REGION_INTERLEAVED = 2 };
+
+enum { RAW_LSU = 0, RAW_ACC = 1, NUM_RAW_TYPES = 2 };
+static const char* const RAW_TYPES[] = {"lsu", "acc"};
+
+static const char* const EXTRA_WB_WARN =
+  "WARNING: %zu transactions still in flight for %s.\n";
+
+static const char* const GENERAL_WARN =
+  "WARNING: Inconsistent final state; performance metrics may be "
+  "inaccurate. Is this trace complete?\n";
+
+// Keys of the annotations emitted by the Snitch tracer in mempool_cc.sv
+#define EXTRA_KEYS(X) \
+  X(source) X(stall) X(stall_tot) X(stall_ins) X(stall_raw) X(stall_lsu) \
+  X(stall_acc) X(rs1) X(rs2) X(rd) X(is_load) X(is_store) X(is_branch) \
+  X(pc_d) X(opa) X(opb) X(opa_select) X(opb_select) X(write_rd) \
+  X(csr_addr) X(writeback) X(gpr_rdata_1) X(ls_size) X(ld_result_32) \
+  X(lsu_rd) X(retire_load) X(alu_result) X(ls_amo) X(retire_acc) \
+  X(acc_pid) X(acc_pdata_32) X(fpu_offload) X(is_seq_insn)
+
+struct extras_t
+{
+#define X(key) uint64_t key = 0;
+  EXTRA_KEYS(X)
+#undef X
+};
+
+// Architecture of the traced system
+struct arch_t
+{
+  unsigned num_cores;
+  unsigned num_tiles;
+  uint64_t seq_mem_size;
+  uint64_t tcdm_size;
+};
+
+struct options_t
+{
+  bool annot_fseq_offl = false;
+  bool force_hex_addr = true;
+  bool allkeys = false;
+  bool permissive = false;
+  string outdir;
+};
+
+// Performance metrics of one benchmark section
+struct section_t
+{
+  long section = -1; // -1 until a `trace' CSR write starts a new section
+  bool has_start = false;
+  uint64_t start = 0;
+  uint64_t end = 0;
+  uint64_t snitch_loads = 0;
+  uint64_t snitch_stores = 0;
+  uint64_t snitch_issues = 0;
+  uint64_t snitch_fseq_offloads = 0;
+  uint64_t stall_tot = 0;
+  uint64_t stall_ins = 0;
+  uint64_t stall_raw = 0;
+  uint64_t stall_raw_type[NUM_RAW_TYPES] = {0, 0};
+  uint64_t stall_lsu = 0;
+  uint64_t stall_acc = 0;
+  vector<uint64_t> snitch_load_latency;
+  vector<int> snitch_load_region;
+  vector<long> snitch_load_tile;
+  vector<int> snitch_store_region;
+  vector<long> snitch_store_tile;
+  // Evaluated metrics
+  uint64_t cycles = 0;
+  double snitch_avg_load_latency = 0.0;
+  double snitch_occupancy = NAN; // None if the section has no cycles
+  uint64_t seq_loads_local = 0, seq_loads_global = 0;
+  uint64_t itl_loads_local = 0, itl_loads_global = 0;
+  double seq_latency_local = NAN, seq_latency_global = NAN;
+  double itl_latency_local = NAN, itl_latency_global = NAN;
+  uint64_t seq_stores_local = 0, seq_stores_global = 0;
+  uint64_t itl_stores_local = 0, itl_stores_global = 0;
+};
+
+// Everything the post-processing of one hart produces
+struct hart_result_t
+{
+  long core_id = -1;
+  vector<section_t> sections;
+  string errors;
+  bool failed = false;
+};
+
+// -------------------- Literal formatting --------------------
+
+static string int_lit(uint64_t num, bool force_hex = false)
+{
+  uint32_t val = num;
+  int32_t val_signed = val;
+  char buf[16];
+  if (force_hex || llabs(val_signed) > MAX_SIGNED_INT_LIT)
+    snprintf(buf, sizeof(buf), "0x%08x", val);
+  else
+    snprintf(buf, sizeof(buf), "%d", val_signed);
+  return buf;
+}
+
+// Shortest representation that reads back to the same value, formatted the
+// way Python's repr() does it
+static string flt_repr(double val)
+{
+  if (std::isnan(val))
+    return "nan";
+  if (std::isinf(val))
+    return val < 0 ? "-inf" : "inf";
+
+  char buf[32];
+  for (int prec = 0; prec < 17; prec++) {
+    snprintf(buf, sizeof(buf), "%.*e", prec, val);
+    if (strtod(buf, NULL) == val)
+      break;
+  }
+
+  string s = buf;
+  string sign;
+  if (s[0] == '-') {
+    sign = "-";
+    s = s.substr(1);
+  }
+  size_t epos = s.find('e');
+  int exp = atoi(s.c_str() + epos + 1);
+  string digits = s.substr(0, epos);
+  digits.erase(std::remove(digits.begin(), digits.end(), '.'), digits.end());
+
+  if (exp < -4 || exp >= 16) {
+    char expbuf[16];
+    snprintf(expbuf, sizeof(expbuf), "e%c%02d", exp < 0 ? '-' : '+', abs(exp));
+    string mant = digits.substr(0, 1);
+    if (digits.size() > 1)
+      mant += "." + digits.substr(1);
+    return sign + mant + expbuf;
+  }
+  if (exp < 0)
+    return sign + "0." + string(-exp - 1, '0') + digits;
+  if (digits.size() <= size_t(exp) + 1)
+    return sign + digits + string(exp + 1 - digits.size(), '0') + ".0";
+  return sign + digits.substr(0, exp + 1) + "." + digits.substr(exp + 1);
+}
+
+static string flt_fmt(double val, int width = 7)
+{
+  // If default literal shorter: use it
+  string default_str = flt_repr(val);
+  if (int(default_str.size()) - 1 <= width)
+    return default_str;
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*f", width, val);
+  return buf;
+}
+
+// -------------------- Trace parsing --------------------
+
+// Parse the annotations of the form {'key': 0x..., ...}
+static void read_annotations(const char* str, extras_t& extras)
+{
+  extras = extras_t();
+  while ((str = strchr(str, '\'')) != NULL) {
+    const char* key = ++str;
+    if ((str = strchr(str, '\'')) == NULL)
+      break;
+    size_t len = str - key;
+    str++;
+    while (isspace(*str))
+      str++;
+    if (*str != ':')
+      continue;
+    str++;
+    while (isspace(*str))
+      str++;
+    if (str[0] != '0' || (str[1] != 'x' && str[1] != 'X'))
+      continue;
+    char* endp;
+    uint64_t val = strtoull(str + 2, &endp, 16);
+    str = endp;
+#define X(name) \
+    if (len == sizeof(#name) - 1 && strncmp(key, #name, len) == 0) { \
+      extras.name = val; \
+      continue; \
+    }
+    EXTRA_KEYS(X)
+#undef X
+  }
+}
+
+// Split a trace line into time, cycle, PC, instruction, and annotations.
+// Mirrors the regular expression of gen_trace.py.
+static bool split_line(const string& line, string& time_str, string& cycle_str,
+                       string& pc_str, string& insn, const char*& extras_str)
+{
+  const char* p = line.c_str();
+  while (*p && !isdigit(*p))
+    p++;
+
+  const char* q = p;
+  while (isdigit(*q))
+    q++;
+  if (q == p || !isspace(*q))
+    return false;
+  time_str.assign(p, q);
+
+  for (p = q; isspace(*p); p++);
+  for (q = p; isdigit(*q); q++);
+  if (q == p || !isspace(*q))
+    return false;
+  cycle_str.assign(p, q);
+
+  for (p = q; isspace(*p); p++);
+  if (p[0] != '0' || p[1] != 'x')
+    return false;
+  for (q = p + 2; isxdigit(*q) || *q == 'z'; q++);
+  if (q == p + 2 || !isspace(*q))
+    return false;
+  pc_str.assign(p, q);
+
+  for (p = q; isspace(*p); p++);
+  for (q = p; *q && *q != '#' && *q != ';'; q++);
+  insn.assign(p, q);
+
+  extras_str = NULL;
+  const char* r = q;
+  if (r[0] == '#' && r[1] == ';')
+    extras_str = r + 2;
+  return true;
+}
+
+// -------------------- Trace sources --------------------
+
+// One traced cycle, read from either trace format
+struct trace_entry_t
+{
+  uint64_t time;
+  uint64_t cycle;
+  string time_str;
+  string cycle_str;
+  string pc_str;
+  string insn;
+  bool has_extras;
+  extras_t extras;
+  // A `csrw trace' starts a new benchmark section
+  bool starts_section;
+};
+
+class trace_source_t
+{
+ public:
+  virtual ~trace_source_t() {}
+  // Read the next entry. Returns false at the end or on an error.
+  virtual bool next(trace_entry_t& entry) = 0;
+  const string& error() const { return err; }
+
+ protected:
+  string err;
+};
+
+// Text traces as written by the tracer with $fwrite
+class text_trace_t : public trace_source_t
+{
+ public:
+  text_trace_t(const string& filename, dasm_cache_t& dasm)
+    : in(filename), dasm(dasm)
+  {
+    if (!in)
+      err = "cannot open " + filename;
+  }
+
+  bool next(trace_entry_t& entry) override
+  {
+    if (!err.empty() || !getline(in, line))
+      return false;
+
+    disassemble_line(line, dasm);
+
+    const char* extras_str;
+    if (!split_line(line, entry.time_str, entry.cycle_str, entry.pc_str,
+                    entry.insn, extras_str)) {
+      err = "Not a valid trace line:\n" + line;
+      return false;
+    }
+    entry.time = strtoull(entry.time_str.c_str(), NULL, 10);
+    entry.cycle = strtoull(entry.cycle_str.c_str(), NULL, 10);
+    entry.has_extras = extras_str != NULL;
+    if (entry.has_extras)
+      read_annotations(extras_str, entry.extras);
+    entry.starts_section = line.find("trace") != string::npos;
+    return true;
+  }
+
+ private:
+  ifstream in;
+  dasm_cache_t& dasm;
+  string line;
+};
+
+// Binary traces as written through the snitch_trace DPI
+class binary_trace_t : public trace_source_t
+{
+ public:
+  binary_trace_t(const string& filename, dasm_cache_t& dasm)
+    : dasm(dasm)
+  {
+    if (!reader.open(filename.c_str()))
+      err = reader.error();
+  }
+
+  bool next(trace_entry_t& entry) override
+  {
+    if (!err.empty())
+      return false;
+    const snitch_trace_record_t* rec = reader.next();
+    if (!rec) {
+      err = reader.error();
+      return false;
+    }
+
+    char buf[16];
+    entry.time = rec->time;
+    entry.cycle = rec->cycle;
+    entry.time_str = to_string(rec->time);
+    entry.cycle_str = to_string(rec->cycle);
+    snprintf(buf, sizeof(buf), "0x%08x", rec->pc);
+    entry.pc_str = buf;
+    // Keep the trailing space of the text trace
+    entry.insn = dasm.disassemble(int32_t(rec->insn)) + " ";
+    entry.starts_section = entry.insn.find("trace") != string::npos;
+
+    extras_t& extras = entry.extras;
+    entry.has_extras = true;
+    extras.source = SRC_SNITCH;
+    extras.stall = (rec->flags & SNITCH_TRACE_STALL) != 0;
+    extras.stall_tot = rec->stall_tot;
+    extras.stall_ins = rec->stall_ins;
+    extras.stall_raw = rec->stall_raw;
+    extras.stall_lsu = rec->stall_lsu;
+    extras.stall_acc = rec->stall_acc;
+    extras.rs1 = rec->rs1;
+    extras.rs2 = rec->rs2;
+    extras.rd = rec->rd;
+    extras.is_load = (rec->flags & SNITCH_TRACE_IS_LOAD) != 0;
+    extras.is_store = (rec->flags & SNITCH_TRACE_IS_STORE) != 0;
+    extras.is_branch = (rec->flags & SNITCH_TRACE_IS_BRANCH) != 0;
+    extras.pc_d = rec->pc_d;
+    extras.opa = rec->opa;
+    extras.opb = rec->opb;
+    extras.opa_select = rec->opa_select;
+    extras.opb_select = rec->opb_select;
+    extras.write_rd = (rec->flags & SNITCH_TRACE_WRITE_RD) != 0;
+    extras.csr_addr = rec->csr_addr;
+    extras.writeback = rec->writeback;
+    extras.gpr_rdata_1 = rec->gpr_rdata_1;
+    extras.ls_size = rec->ls_size;
+    extras.ld_result_32 = rec->ld_result_32;
+    extras.lsu_rd = rec->lsu_rd;
+    extras.retire_load = (rec->flags & SNITCH_TRACE_RETIRE_LOAD) != 0;
+    extras.alu_result = rec->alu_result;
+    extras.ls_amo = (rec->flags & SNITCH_TRACE_LS_AMO) != 0;
+    extras.retire_acc = (rec->flags & SNITCH_TRACE_RETIRE_ACC) != 0;
+    extras.acc_pid = rec->acc_pid;
+    extras.acc_pdata_32 = rec->acc_pdata_32;
+    extras.fpu_offload = (rec->flags & SNITCH_TRACE_FPU_OFFLOAD) != 0;
+    extras.is_seq_insn = (rec->flags & SNITCH_TRACE_IS_SEQ_INSN) != 0;
+    return true;
+  }
+
+ private:
+  snitch_trace_reader_t reader;
+  dasm_cache_t& dasm;
+};
+
+// -------------------- Annotation --------------------
+
+static void addr_to_meta(const arch_t& arch, uint64_t address, int& region,
+                         long& tile)
+{
+  region = REGION_OTHER;
+  tile = -1;
+  if (address < arch.seq_mem_size * arch.num_tiles) {
+    // Local memory
+    region = REGION_SEQUENTIAL;
+    tile = address / arch.seq_mem_size;
+  } else if (address < arch.tcdm_size) {
+    // Interleaved memory
+    region = REGION_INTERLEAVED;
+    tile = (address / 64) % arch.num_tiles;
+  }
+}
+
+struct annotator_t
+{
+  const arch_t& arch;
+  const options_t& opts;
+  hart_result_t& result;
+  // One FIFO per GPR storing start cycles and addresses of each load
+  deque<pair<uint64_t, uint64_t>> gpr_wb_info[32];
+  long retired_reg[NUM_RAW_TYPES] = {-1, -1};
+
+  annotator_t(const arch_t& arch, const options_t& opts,
+              hart_result_t& result)
+    : arch(arch), opts(opts), result(result) {}
+
+  section_t& curr() { return result.sections.back(); }
+
+  void report(const char* fmt, uint64_t cycle, const char* what)
+  {
+    char buf[256];
+    snprintf(buf, sizeof(buf), fmt, opts.permissive ? "WARNING" : "FATAL",
+             (unsigned long long)cycle, what);
+    result.errors += buf;
+    if (!opts.permissive)
+      result.failed = true;
+  }
+
+  string annotate_snitch(const extras_t& extras, uint64_t cycle,
+                         uint64_t last_cycle, uint64_t pc)
+  {
+    // Compound annotations in datapath order
+    vector<string> ret;
+    // Remember if we had a potential RAW stall
+    long raw_stall[NUM_RAW_TYPES] = {0, 0};
+    char buf[64];
+    // If Sequencer offload: annotate if desired
+    if (opts.annot_fseq_offl && extras.fpu_offload) {
+      snprintf(buf, sizeof(buf), "%s <~~ 0x%08llx",
+               extras.is_seq_insn ? "FSEQ" : "FPSS", (unsigned long long)pc);
+      ret.push_back(buf);
+    }
+    // Regular linear datapath operation
+    if (!(extras.stall || extras.fpu_offload)) {
+      // Operand registers
+      if (extras.opa_select == OPER_GPR && extras.rs1 != 0) {
+        snprintf(buf, sizeof(buf), "%-3s = ", REG_ABI_NAMES_I[extras.rs1 % 32]);
+        ret.push_back(buf + int_lit(extras.opa));
+        for (int k = 0; k < NUM_RAW_TYPES; k++)
+          if (long(extras.rs1) == retired_reg[k])
+            raw_stall[k] = retired_reg[k];
+      }
+      if (extras.opb_select == OPER_GPR && extras.rs2 != 0) {
+        snprintf(buf, sizeof(buf), "%-3s = ", REG_ABI_NAMES_I[extras.rs2 % 32]);
+        ret.push_back(buf + int_lit(extras.opb));
+        for (int k = 0; k < NUM_RAW_TYPES; k++)
+          if (long(extras.rs2) == retired_reg[k])
+            raw_stall[k] = retired_reg[k];
+      }
+      // CSR (always operand b)
+      if (extras.opb_select == OPER_CSR) {
+        uint64_t cycles_past = extras.opb;
+        if (extras.csr_addr == 0xb00) {
+          curr().end = cycles_past;
+          result.sections.emplace_back();
+          curr().has_start = true;
+          curr().start = cycles_past + 2;
+          ret.push_back("mcycle = " + int_lit(cycles_past));
+        } else if (extras.csr_addr == 0xf14) {
+          ret.push_back("mhartid = " + int_lit(cycles_past));
+        } else {
+          snprintf(buf, sizeof(buf), "csr@%llx = ",
+                   (unsigned long long)extras.csr_addr);
+          ret.push_back(buf + int_lit(cycles_past));
+        }
+      }
+      // Load / Store
+      if (extras.is_load) {
+        curr().snitch_loads++;
+        gpr_wb_info[extras.rd % 32].emplace_front(cycle, extras.alu_result);
+        snprintf(buf, sizeof(buf), "%-3s <~~ %s[", REG_ABI_NAMES_I[extras.rd % 32],
+                 LS_SIZES[extras.ls_size % 4]);
+        ret.push_back(buf + int_lit(extras.alu_result, opts.force_hex_addr) +
+                      "]");
+      } else if (extras.is_store) {
+        curr().snitch_stores++;
+        ret.push_back(int_lit(extras.gpr_rdata_1) + " ~~> " +
+                      LS_SIZES[extras.ls_size % 4] + "[" +
+                      int_lit(extras.alu_result, opts.force_hex_addr) + "]");
+        int region;
+        long tile;
+        addr_to_meta(arch, extras.alu_result, region, tile);
+        curr().snitch_store_region.push_back(region);
+        curr().snitch_store_tile.push_back(tile);
+      }
+      // Branches: all reg-reg ops
+      else if (extras.is_branch) {
+        ret.push_back(extras.alu_result ? "taken" : "not taken");
+      }
+      // Datapath (ALU / Jump Target / Bypass) register writeback
+      if (extras.write_rd && extras.rd != 0) {
+        snprintf(buf, sizeof(buf), "(wrb) %-3s <-- ",
+                 REG_ABI_NAMES_I[extras.rd % 32]);
+        ret.push_back(buf + int_lit(extras.writeback));
+      }
+    }
+    // Retired loads and accelerator (includes FPU) data: can come back on
+    // stall and during other ops
+    if (extras.retire_load && extras.lsu_rd != 0) {
+      const char* lsu_rd = REG_ABI_NAMES_I[extras.lsu_rd % 32];
+      deque<pair<uint64_t, uint64_t>>& wb = gpr_wb_info[extras.lsu_rd % 32];
+      if (!wb.empty()) {
+        uint64_t start_time = wb.back().first;
+        int region;
+        long tile;
+        addr_to_meta(arch, wb.back().second, region, tile);
+        wb.pop_back();
+        curr().snitch_load_latency.push_back(cycle - start_time);
+        curr().snitch_load_region.push_back(region);
+        curr().snitch_load_tile.push_back(tile);
+      } else {
+        report("%s: In cycle %llu, LSU attempts writeback to %s, but none in "
+               "flight.\n", cycle, lsu_rd);
+      }
+      snprintf(buf, sizeof(buf), "(lsu) %-3s <-- ", lsu_rd);
+      ret.push_back(buf + int_lit(extras.ld_result_32));
+      retired_reg[RAW_LSU] = extras.lsu_rd;
+    } else {
+      retired_reg[RAW_LSU] = 0;
+    }
+    if (extras.retire_acc && extras.acc_pid != 0) {
+      snprintf(buf, sizeof(buf), "(acc) %-3s <-- ",
+               REG_ABI_NAMES_I[extras.acc_pid % 32]);
+      ret.push_back(buf + int_lit(extras.acc_pdata_32));
+      retired_reg[RAW_ACC] = extras.acc_pid;
+    } else {
+      retired_reg[RAW_ACC] = 0;
+    }
+    // Any kind of PC change: Branch, Jump, etc.
+    if (!extras.stall && extras.pc_d != pc + 4)
+      ret.push_back("goto " + int_lit(extras.pc_d));
+    // Count stalls, but only in cycles that execute an instruction
+    if (!extras.stall) {
+      section_t& sec = curr();
+      if (extras.stall_tot) {
+        ret.push_back("// stall " + to_string(extras.stall_tot) + " cycles");
+        sec.stall_tot += extras.stall_tot;
+        if (extras.stall_ins) {
+          sec.stall_ins += extras.stall_ins;
+          ret.push_back("(" + to_string(extras.stall_ins) + " ins)");
+        }
+        if (extras.stall_raw) {
+          sec.stall_raw += extras.stall_raw;
+          ret.push_back("(" + to_string(extras.stall_raw) + " raw");
+          for (int k = 0; k < NUM_RAW_TYPES; k++) {
+            if (raw_stall[k] > 0) {
+              ret.push_back(string(RAW_TYPES[k]) + ":" +
+                            REG_ABI_NAMES_I[raw_stall[k] % 32] + ")");
+              sec.stall_raw_type[k] += extras.stall_raw;
+            }
+          }
+        }
+        if (extras.stall_lsu) {
+          sec.stall_lsu += extras.stall_lsu;
+          ret.push_back("(" + to_string(extras.stall_lsu) + " lsu)");
+        }
+        if (extras.stall_acc) {
+          sec.stall_acc += extras.stall_acc;
+          ret.push_back("(" + to_string(extras.stall_acc) + " acc)");
+        }
+      } else if (extras.stall_ins || extras.stall_raw || extras.stall_lsu ||
+                 extras.stall_acc) {
+        ret.push_back("// Missed specific stall!!!");
+      } else if (cycle - last_cycle > 1) {
+        // Check if we did not skip a cycle, otherwise we probably had a
+        // undetected stall
+        ret.push_back("// Potentially missed stall cycle (" +
+                      to_string(cycle - last_cycle - 1) + " cycles)!!!");
+      }
+    }
+    // Return comma-delimited list
+    string annot;
+    for (size_t i = 0; i < ret.size(); i++)
+      annot += (i ? ", " : "") + ret[i];
+    return annot;
+  }
+};
+
+// -------------------- Performance metrics --------------------
+
+static double mean(const vector<uint64_t>& values, const vector<bool>& select)
+{
+  uint64_t sum = 0, count = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (select[i]) {
+      sum += values[i];
+      count++;
+    }
+  }
+  return count ? double(sum) / count : NAN;
+}
+
+static void eval_perf_metrics(vector<section_t>& sections, long core_id)
+{
+  long tile_id = core_id / 4;
+  for (section_t& seg : sections) {
+    seg.cycles = seg.end - seg.start + 1;
+    vector<bool> all(seg.snitch_load_latency.size(), true);
+    seg.snitch_avg_load_latency = all.empty() ? 0.0 :
+                                  mean(seg.snitch_load_latency, all);
+    seg.snitch_occupancy = seg.cycles ? double(seg.snitch_issues) / seg.cycles
+                                      : NAN;
+    // Detailed load/store info
+    if (seg.snitch_loads > 0) {
+      size_t n = seg.snitch_load_latency.size();
+      vector<bool> seq_local(n), seq_global(n), itl_local(n), itl_global(n);
+      for (size_t i = 0; i < n; i++) {
+        bool local = seg.snitch_load_tile[i] == tile_id;
+        bool seq = seg.snitch_load_region[i] == REGION_SEQUENTIAL;
+        bool itl = seg.snitch_load_region[i] == REGION_INTERLEAVED;
+        seq_local[i] = seq && local;
+        seq_global[i] = seq && !local;
+        itl_local[i] = itl && local;
+        itl_global[i] = itl && !local;
+      }
+      seg.seq_loads_local = count(seq_local.begin(), seq_local.end(), true);
+      seg.seq_loads_global = count(seq_global.begin(), seq_global.end(), true);
+      seg.itl_loads_local = count(itl_local.begin(), itl_local.end(), true);
+      seg.itl_loads_global = count(itl_global.begin(), itl_global.end(), true);
+      seg.seq_latency_local = mean(seg.snitch_load_latency, seq_local);
+      seg.seq_latency_global = mean(seg.snitch_load_latency, seq_global);
+      seg.itl_latency_local = mean(seg.snitch_load_latency, itl_local);
+      seg.itl_latency_global = mean(seg.snitch_load_latency, itl_global);
+    }
+    if (seg.snitch_stores > 0) {
+      for (size_t i = 0; i < seg.snitch_store_region.size(); i++) {
+        bool local = seg.snitch_store_tile[i] == tile_id;
+        if (seg.snitch_store_region[i] == REGION_SEQUENTIAL)
+          (local ? seg.seq_stores_local : seg.seq_stores_global)++;
+        else if (seg.snitch_store_region[i] == REGION_INTERLEAVED)
+          (local ? seg.itl_stores_local : seg.itl_stores_global)++;
+      }
+    }
+  }
+}
+
+template <typename T>
+static string list_str(const vector<T>& values)
+{
+  string s = "[";
+  for (size_t i = 0; i < values.size(); i++)
+    s += (i ? ", " : "") + to_string(values[i]);
+  return s + "]";
+}
+
+// A metric as printed in the trace (`text') and in the CSV file (`csv')
+struct metric_t
+{
+  const char* key;
+  bool omit; // Only serves to compute other metrics
+  string text;
+  string csv;
+};
+
+static vector<metric_t> section_metrics(const section_t& sec, long core_id)
+{
+  struct
+  {
+    metric_t operator()(const char* key, uint64_t val, bool omit = false)
+    {
+      return {key, omit, int_lit(val), to_string(val)};
+    }
+    metric_t operator()(const char* key, double val, bool none = false)
+    {
+      if (none && std::isnan(val))
+        return {key, false, "None", ""};
+      return {key, false, flt_fmt(val, 4), flt_repr(val)};
+    }
+    metric_t operator()(const char* key, const string& val)
+    {
+      return {key, true, val, val};
+    }
+  } m;
+
+  // The order of the CSV columns
+  return {
+    m("core", to_string(core_id)),
+    m("section", sec.section < 0 ? string() : to_string(sec.section)),
+    m("start", sec.start, true),
+    m("end", sec.end, true),
+    m("cycles", sec.cycles),
+    m("snitch_loads", sec.snitch_loads),
+    m("snitch_stores", sec.snitch_stores),
+    m("snitch_avg_load_latency", sec.snitch_avg_load_latency),
+    m("snitch_occupancy", sec.snitch_occupancy, true),
+    m("snitch_load_latency", list_str(sec.snitch_load_latency)),
+    m("total_ipc", sec.snitch_occupancy, true),
+    m("snitch_issues", sec.snitch_issues),
+    m("stall_tot", sec.stall_tot),
+    m("stall_ins", sec.stall_ins),
+    m("stall_raw", sec.stall_raw),
+    m("stall_raw_lsu", sec.stall_raw_type[RAW_LSU]),
+    m("stall_raw_acc", sec.stall_raw_type[RAW_ACC]),
+    m("stall_lsu", sec.stall_lsu),
+    m("stall_acc", sec.stall_acc),
+    m("snitch_fseq_offloads", sec.snitch_fseq_offloads),
+    m("seq_loads_local", sec.seq_loads_local),
+    m("seq_loads_global", sec.seq_loads_global),
+    m("itl_loads_local", sec.itl_loads_local),
+    m("itl_loads_global", sec.itl_loads_global),
+    m("seq_latency_local", sec.seq_latency_local),
+    m("seq_latency_global", sec.seq_latency_global),
+    m("itl_latency_local", sec.itl_latency_local),
+    m("itl_latency_global", sec.itl_latency_global),
+    m("seq_stores_local", sec.seq_stores_local),
+    m("seq_stores_global", sec.seq_stores_global),
+    m("itl_stores_local", sec.itl_stores_local),
+    m("itl_stores_global", sec.itl_stores_global),
+    m("snitch_load_region", list_str(sec.snitch_load_region)),
+    m("snitch_load_tile", list_str(sec.snitch_load_tile)),
+    m("snitch_store_region", list_str(sec.snitch_store_region)),
+    m("snitch_store_tile", list_str(sec.snitch_store_tile)),
+  };
+}
+
+static void fmt_perf_metrics(ostream& out, const hart_result_t& result,
+                             size_t idx, bool omit_keys)
+{
+  const section_t& sec = result.sections[idx];
+  out << "\nPerformance metrics for section " << idx << " @ (" << sec.start
+      << ", " << sec.end << "):\n";
+  vector<metric_t> metrics = section_metrics(sec, result.core_id);
+  sort(metrics.begin(), metrics.end(),
+       [](const metric_t& a, const metric_t& b) {
+         return strcmp(a.key, b.key) < 0;
+       });
+  char buf[128];
+  for (const metric_t& metric : metrics) {
+    if (omit_keys && metric.omit)
+      continue;
+    snprintf(buf, sizeof(buf), "%-40s%10s\n", metric.key, metric.text.c_str());
+    out << buf;
+  }
+}
+
+static string csv_field(const string& field)
+{
+  if (field.find_first_of(",\"\r\n") == string::npos)
+    return field;
+  string quoted = "\"";
+  for (char c : field)
+    quoted += c == '"' ? string("\"\"") : string(1, c);
+  return quoted + "\"";
+}
+
+static bool perf_metrics_to_csv(const vector<hart_result_t>& results,
+                                const string& filename)
+{
+  bool write_header = !ifstream(filename).good();
+  ofstream out(filename, ios::app);
+  if (!out) {
+    fprintf(stderr, "cannot open %s for writing\n", filename.c_str());
+    return false;
+  }
+  for (const hart_result_t& result : results) {
+    for (const section_t& sec : result.sections) {
+      vector<metric_t> metrics = section_metrics(sec, result.core_id);
+      if (write_header) {
+        for (size_t i = 0; i < metrics.size(); i++)
+          out << (i ? "," : "") << metrics[i].key;
+        out << '\n';
+        write_header = false;
+      }
+      for (size_t i = 0; i < metrics.size(); i++)
+        out << (i ? "," : "") << csv_field(metrics[i].csv);
+      out << '\n';
+    }
+  }
+  return true;
+}
+
+// -------------------- Main --------------------
+
+static void process_trace(const string& infile, const string& outfile,
+                          const arch_t& arch, const options_t& opts,
+                          const disassembler_t& disassembler,
+                          hart_result_t& result)
+{
+  dasm_cache_t dasm(disassembler);
+  unique_ptr<trace_source_t> source;
+  if (snitch_trace_reader_t::is_binary(infile.c_str()))
+    source.reset(new binary_trace_t(infile, dasm));
+  else
+    source.reset(new text_trace_t(infile, dasm));
+  if (!source->error().empty()) {
+    result.errors += "FATAL: " + source->error() + "\n";
+    result.failed = true;
+    return;
+  }
+  ofstream out(outfile);
+  if (!out) {
+    result.errors += "FATAL: cannot open " + outfile + " for writing\n";
+    result.failed = true;
+    return;
+  }
+
+  size_t slash = infile.rfind('/');
+  const char* filename = infile.c_str() + (slash == string::npos ? 0 : slash + 1);
+  while (*filename && !isdigit(*filename))
+    filename++;
+  result.core_id = *filename ? atol(filename) : -1;
+
+  annotator_t annotator(arch, opts, result);
+  result.sections.emplace_back();
+  long section = 0;
+  uint64_t last_time = 0, last_cycle = 0;
+  trace_entry_t entry;
+  char buf[128];
+
+  while (!result.failed && source->next(entry)) {
+    bool show_time_info = entry.time != last_time || entry.cycle != last_cycle;
+    string annot;
+    bool empty = false;
+
+    if (entry.has_extras) {
+      const extras_t& extras = entry.extras;
+      if (extras.source != SRC_SNITCH) {
+        // MemPool's cores have neither an FPU subsystem nor a sequencer
+        result.errors += "FATAL: Unsupported trace source " +
+                         to_string(extras.source) + "\n";
+        result.failed = true;
+        break;
+      }
+      annot = annotator.annotate_snitch(extras, entry.cycle, last_cycle,
+                                        strtoull(entry.pc_str.c_str(), NULL, 16));
+      if (extras.fpu_offload)
+        result.sections.back().snitch_fseq_offloads++;
+      if (extras.stall || extras.fpu_offload) {
+        entry.insn.clear();
+        entry.pc_str.clear();
+      } else {
+        result.sections.back().snitch_issues++;
+      }
+      // Omit empty trace lines (due to double stalls, performance measures)
+      empty = entry.insn.empty() && annot.empty();
+    }
+
+    if (!empty) {
+      last_time = entry.time;
+      last_cycle = entry.cycle;
+    }
+    if (!result.sections.front().has_start) {
+      result.sections.front().has_start = true;
+      result.sections.front().start = last_cycle;
+    }
+    // Start a new benchmark section after 'csrw trace' instruction
+    if (entry.starts_section) {
+      result.sections.back().end = last_cycle;
+      result.sections.emplace_back();
+      result.sections.back().section = section++;
+      result.sections.back().has_start = true;
+      result.sections.back().start = last_cycle;
+    }
+    if (empty)
+      continue;
+
+    snprintf(buf, sizeof(buf), "%8s %8s %10s ",
+             show_time_info ? entry.time_str.c_str() : "",
+             show_time_info ? entry.cycle_str.c_str() : "",
+             entry.pc_str.c_str());
+    out << buf << entry.insn;
+    if (entry.insn.size() < 30)
+      out << string(30 - entry.insn.size(), ' ');
+    if (entry.has_extras)
+      out << " #; " << annot;
+    out << '\n';
+  }
+  if (!source->error().empty()) {
+    result.errors += "FATAL: " + source->error() + "\n";
+    result.failed = true;
+  }
+
+  vector<section_t>& sections = result.sections;
+  if (result.failed) {
+    sections.clear();
+    return;
+  }
+  sections.back().end = last_cycle;
+  // Remove last empty entry
+  if (sections.back().start == sections.back().end)
+    sections.pop_back();
+  if (sections.empty() || !sections.front().has_start) {
+    result.errors += "WARNING: Empty trace file (" + infile + ").\n";
+    sections.clear();
+    return;
+  }
+
+  // Compute metrics
+  eval_perf_metrics(sections, result.core_id);
+
+  // Emit metrics
+  out << "\n## Performance metrics\n";
+  for (size_t idx = 0; idx < sections.size(); idx++)
+    fmt_perf_metrics(out, result, idx, !opts.allkeys);
+
+  // Check for any loose ends and warn before exiting
+  bool warn_trip = false;
+  for (int gpr = 0; gpr < 32; gpr++) {
+    size_t in_flight = annotator.gpr_wb_info[gpr].size();
+    if (in_flight) {
+      warn_trip = true;
+      snprintf(buf, sizeof(buf), EXTRA_WB_WARN, in_flight, REG_ABI_NAMES_I[gpr]);
+      result.errors += buf;
+    }
+  }
+  if (warn_trip)
+    result.errors += GENERAL_WARN;
+}
+
+static string output_name(const string& infile, const string& outdir)
+{
+  size_t slash = infile.rfind('/');
+  string dir = slash == string::npos ? "." : infile.substr(0, slash);
+  string base = slash == string::npos ? infile : infile.substr(slash + 1);
+  for (const char* ext : {".dasm", ".bin"}) {
+    size_t dot = base.rfind(ext);
+    if (dot != string::npos && dot + strlen(ext) == base.size())
+      base = base.substr(0, dot);
+  }
+  return (outdir.empty() ? dir : outdir) + "/" + base + ".trace";
+}
+
+static void help()
+{
+  fprintf(stderr, "usage: mempool-trace [options] trace_hart_XXXX.{dasm,bin}...\n");
+  fprintf(stderr, "Annotates the traces of the MemPool cores and computes their performance metrics.\n");
+  fprintf(stderr, "Writes the annotated trace of each input to <name>.trace.\n\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -o, --offl            Annotate FPSS and sequencer offloads when they happen in core\n");
+  fprintf(stderr, "  -s, --saddr           Use signed decimal (not unsigned hex) for small addresses\n");
+  fprintf(stderr, "  -a, --allkeys         Include performance metrics measured to compute others\n");
+  fprintf(stderr, "  -p, --permissive      Ignore some state-related issues when they occur\n");
+  fprintf(stderr, "  -c, --csv=<file>      Append the performance metrics to <file>\n");
+  fprintf(stderr, "  -d, --outdir=<dir>    Write the annotated traces to <dir> [default: next to the input]\n");
+  fprintf(stderr, "  -j, --jobs=<n>        Process <n> traces in parallel [default: all host cores]\n");
+  fprintf(stderr, "      --num-cores=<n>   Number of cores of the traced system [default: $num_cores or 256]\n");
+  fprintf(stderr, "      --isa=<name>      RISC-V ISA string [default %s]\n", DEFAULT_ISA);
+#ifdef HAVE_DLOPEN
+  fprintf(stderr, "      --extension=<name> Specify RoCC Extension\n");
+#endif
+  exit(1);
+}
+
+int main(int argc, char** argv)
+{
+  const char* isa = DEFAULT_ISA;
+  const char* num_cores_env = getenv("num_cores");
+  unsigned num_cores = num_cores_env ? atoi(num_cores_env) : 256;
+  unsigned jobs = std::thread::hardware_concurrency();
+  string csv_file;
+  options_t opts;
+
+  std::function<extension_t*()> extension;
+  option_parser_t parser;
+  parser.help(&help);
+  parser.option('h', "help", 0, [&](const char* s){help();});
+  parser.option('o', "offl", 0, [&](const char* s){opts.annot_fseq_offl = true;});
+  parser.option('s', "saddr", 0, [&](const char* s){opts.force_hex_addr = false;});
+  parser.option('a', "allkeys", 0, [&](const char* s){opts.allkeys = true;});
+  parser.option('p', "permissive", 0, [&](const char* s){opts.permissive = true;});
+  parser.option('c', "csv", 1, [&](const char* s){csv_file = s;});
+  parser.option('d', "outdir", 1, [&](const char* s){opts.outdir = s;});
+  parser.option('j', "jobs", 1, [&](const char* s){jobs = atoi(s);});
+  parser.option(0, "num-cores", 1, [&](const char* s){num_cores = atoi(s);});
+#ifdef HAVE_DLOPEN
+  parser.option(0, "extension", 1, [&](const char* s){extension = find_extension(s);});
+#endif
+  parser.option(0, "isa", 1, [&](const char* s){isa = s;});
+  const char* const* argv1 = parser.parse(argv);
+
+  vector<string> infiles(argv1, (const char* const*)argv + argc);
+  if (infiles.empty())
+    help();
+
+  std::string lowercase;
+  for (const char *p = isa; *p; p++)
+    lowercase += std::tolower(*p);
+
+  int xlen;
+  if (lowercase.compare(0, 4, "rv32") == 0) {
+    xlen = 32;
+  } else if (lowercase.compare(0, 4, "rv64") == 0) {
+    xlen = 64;
+  } else {
+    fprintf(stderr, "bad ISA string: %s\n", isa);
+    return 1;
+  }
+
+  if (num_cores < 4) {
+    fprintf(stderr, "bad number of cores: %u\n", num_cores);
+    return 1;
+  }
+  arch_t arch;
+  arch.num_cores = num_cores;
+  arch.num_tiles = num_cores / 4;
+  arch.seq_mem_size = 4 * 1024;
+  arch.tcdm_size = 16 * 1024 * arch.num_tiles;
+
+  // The disassembler is only read from here on and shared by all threads
+  disassembler_t* disassembler = new disassembler_t(xlen);
+  if (extension) {
+    for (auto disasm_insn : extension()->get_disasms()) {
+      disassembler->add_insn(disasm_insn);
+    }
+  }
+
+  vector<hart_result_t> results(infiles.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t i; (i = next++) < infiles.size(); ) {
+      process_trace(infiles[i], output_name(infiles[i], opts.outdir), arch,
+                    opts, *disassembler, results[i]);
+    }
+  };
+
+  jobs = std::max(1u, std::min<unsigned>(jobs, infiles.size()));
+  vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
+
+  // Report in the order of the inputs
+  int ret = 0;
+  for (size_t i = 0; i < infiles.size(); i++) {
+    if (!results[i].errors.empty())
+      fprintf(stderr, "%s: %s", infiles[i].c_str(), results[i].errors.c_str());
+    if (results[i].failed)
+      ret = 1;
+  }
+
+  if (!csv_file.empty()) {
+    if (!perf_metrics_to_csv(results, csv_file))
+      return 1;
+    printf("Wrote performance metrics to %s\n", csv_file.c_str());
+  }
+
+  return ret;
+}
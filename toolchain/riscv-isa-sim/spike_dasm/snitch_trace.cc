@@ -0,0 +1,142 @@
+// See LICENSE for license details.
+
+#include "snitch_trace.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Records read at once if the file cannot be mapped
+static const size_t CHUNK_RECORDS = 4096;
+
+snitch_trace_reader_t::snitch_trace_reader_t()
+  : map(NULL), map_size(0), map_pos(0), file(NULL), chunk_pos(0), chunk_len(0)
+{
+  memset(&hdr, 0, sizeof(hdr));
+}
+
+snitch_trace_reader_t::~snitch_trace_reader_t()
+{
+  close();
+}
+
+bool snitch_trace_reader_t::is_binary(const char* filename)
+{
+  char magic[sizeof(hdr.magic)];
+  FILE* f = fopen(filename, "rb");
+  if (!f)
+    return false;
+  bool binary = fread(magic, 1, sizeof(magic), f) == sizeof(magic) &&
+                memcmp(magic, SNITCH_TRACE_MAGIC, sizeof(magic)) == 0;
+  fclose(f);
+  return binary;
+}
+
+bool snitch_trace_reader_t::open(const char* filename)
+{
+  close();
+
+  int fd = ::open(filename, O_RDONLY);
+  if (fd < 0) {
+    err = std::string("cannot open ") + filename + ": " + strerror(errno);
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      map = (const char*)p;
+      map_size = st.st_size;
+      ::close(fd);
+      if (map_size < sizeof(hdr)) {
+        err = std::string(filename) + ": truncated header";
+        return false;
+      }
+      memcpy(&hdr, map, sizeof(hdr));
+      map_pos = sizeof(hdr);
+      return check_header();
+    }
+  }
+
+  file = fdopen(fd, "rb");
+  if (!file) {
+    err = std::string("cannot open ") + filename + ": " + strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  if (fread(&hdr, sizeof(hdr), 1, file) != 1) {
+    err = std::string(filename) + ": truncated header";
+    return false;
+  }
+  chunk.resize(CHUNK_RECORDS);
+  return check_header();
+}
+
+bool snitch_trace_reader_t::check_header()
+{
+  snitch_trace_le(hdr);
+  if (memcmp(hdr.magic, SNITCH_TRACE_MAGIC, sizeof(hdr.magic)) != 0) {
+    err = "not a binary Snitch trace";
+    return false;
+  }
+  if (hdr.version != SNITCH_TRACE_VERSION ||
+      hdr.record_size != sizeof(snitch_trace_record_t)) {
+    err = "unsupported trace version " + std::to_string(hdr.version);
+    return false;
+  }
+  return true;
+}
+
+void snitch_trace_reader_t::close()
+{
+  if (map)
+    munmap((void*)map, map_size);
+  if (file)
+    fclose(file);
+  map = NULL;
+  map_size = map_pos = 0;
+  file = NULL;
+  chunk_pos = chunk_len = 0;
+}
+
+const snitch_trace_record_t* snitch_trace_reader_t::next()
+{
+  if (map) {
+    if (map_pos + sizeof(snitch_trace_record_t) > map_size) {
+      if (map_pos != map_size)
+        err = "truncated record at the end of the trace";
+      return NULL;
+    }
+    // Records are 8-byte aligned after the header
+    const snitch_trace_record_t* rec =
+      (const snitch_trace_record_t*)(map + map_pos);
+    map_pos += sizeof(snitch_trace_record_t);
+    if (!SNITCH_TRACE_LITTLE_ENDIAN) {
+      swapped = *rec;
+      snitch_trace_le(swapped);
+      return &swapped;
+    }
+    return rec;
+  }
+
+  if (!file)
+    return NULL;
+  if (chunk_pos == chunk_len) {
+    // Read bytes, fread only comes up short at the end of the input
+    size_t bytes = fread(chunk.data(), 1,
+                         chunk.size() * sizeof(snitch_trace_record_t), file);
+    chunk_len = bytes / sizeof(snitch_trace_record_t);
+    chunk_pos = 0;
+    if (bytes % sizeof(snitch_trace_record_t))
+      err = "truncated record at the end of the trace";
+    if (chunk_len == 0)
+      return NULL;
+    for (size_t i = 0; i < chunk_len; i++)
+      snitch_trace_le(chunk[i]);
+  }
+  return &chunk[chunk_pos++];
+}
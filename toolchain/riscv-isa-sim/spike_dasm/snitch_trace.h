@@ -0,0 +1,165 @@
+// See LICENSE for license details.
+
+// Binary trace format of the Snitch tracer in MemPool (mempool_cc.sv) and a
+// reader that streams such traces. A trace file starts with a header and is
+// followed by one fixed-size record per traced cycle. All values are stored
+// little-endian. The format is written by hardware/tb/dpi/snitch_trace.cpp.
+
+#ifndef _SNITCH_TRACE_H
+#define _SNITCH_TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#define SNITCH_TRACE_MAGIC "SNTRACE"
+#define SNITCH_TRACE_VERSION 1
+
+// Single-bit fields of a record
+enum
+{
+  SNITCH_TRACE_STALL       = 1 << 0,
+  SNITCH_TRACE_IS_LOAD     = 1 << 1,
+  SNITCH_TRACE_IS_STORE    = 1 << 2,
+  SNITCH_TRACE_IS_BRANCH   = 1 << 3,
+  SNITCH_TRACE_WRITE_RD    = 1 << 4,
+  SNITCH_TRACE_RETIRE_LOAD = 1 << 5,
+  SNITCH_TRACE_LS_AMO      = 1 << 6,
+  SNITCH_TRACE_RETIRE_ACC  = 1 << 7,
+  SNITCH_TRACE_FPU_OFFLOAD = 1 << 8,
+  SNITCH_TRACE_IS_SEQ_INSN = 1 << 9,
+};
+
+struct snitch_trace_header_t
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t hart_id;
+  uint32_t reserved;
+};
+
+// The same information as the annotations of the text trace
+struct snitch_trace_record_t
+{
+  uint64_t time;
+  uint64_t cycle;
+  uint32_t pc;
+  uint32_t insn;
+  uint32_t pc_d;
+  uint32_t opa;
+  uint32_t opb;
+  uint32_t writeback;
+  uint32_t gpr_rdata_1;
+  uint32_t ld_result_32;
+  uint32_t alu_result;
+  uint32_t acc_pdata_32;
+  uint32_t stall_tot;
+  uint32_t stall_ins;
+  uint32_t stall_raw;
+  uint32_t stall_lsu;
+  uint32_t stall_acc;
+  uint16_t csr_addr;
+  uint16_t flags;
+  uint8_t rs1;
+  uint8_t rs2;
+  uint8_t rd;
+  uint8_t lsu_rd;
+  uint8_t acc_pid;
+  uint8_t opa_select;
+  uint8_t opb_select;
+  uint8_t ls_size;
+};
+
+static_assert(sizeof(snitch_trace_header_t) == 24, "unexpected header size");
+static_assert(sizeof(snitch_trace_record_t) == 88, "unexpected record size");
+
+// Converts a header or record between little-endian and the byte order of the
+// host, in place. Both directions are the same swap, which is a no-op on
+// little-endian hosts.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SNITCH_TRACE_LITTLE_ENDIAN 0
+#define SNITCH_TRACE_SWAP(x) x = snitch_trace_swap(x)
+static inline uint16_t snitch_trace_swap(uint16_t n) { return __builtin_bswap16(n); }
+static inline uint32_t snitch_trace_swap(uint32_t n) { return __builtin_bswap32(n); }
+static inline uint64_t snitch_trace_swap(uint64_t n) { return __builtin_bswap64(n); }
+
+static inline void snitch_trace_le(snitch_trace_header_t& h)
+{
+  SNITCH_TRACE_SWAP(h.version);
+  SNITCH_TRACE_SWAP(h.record_size);
+  SNITCH_TRACE_SWAP(h.hart_id);
+  SNITCH_TRACE_SWAP(h.reserved);
+}
+
+static inline void snitch_trace_le(snitch_trace_record_t& r)
+{
+  SNITCH_TRACE_SWAP(r.time);
+  SNITCH_TRACE_SWAP(r.cycle);
+  SNITCH_TRACE_SWAP(r.pc);
+  SNITCH_TRACE_SWAP(r.insn);
+  SNITCH_TRACE_SWAP(r.pc_d);
+  SNITCH_TRACE_SWAP(r.opa);
+  SNITCH_TRACE_SWAP(r.opb);
+  SNITCH_TRACE_SWAP(r.writeback);
+  SNITCH_TRACE_SWAP(r.gpr_rdata_1);
+  SNITCH_TRACE_SWAP(r.ld_result_32);
+  SNITCH_TRACE_SWAP(r.alu_result);
+  SNITCH_TRACE_SWAP(r.acc_pdata_32);
+  SNITCH_TRACE_SWAP(r.stall_tot);
+  SNITCH_TRACE_SWAP(r.stall_ins);
+  SNITCH_TRACE_SWAP(r.stall_raw);
+  SNITCH_TRACE_SWAP(r.stall_lsu);
+  SNITCH_TRACE_SWAP(r.stall_acc);
+  SNITCH_TRACE_SWAP(r.csr_addr);
+  SNITCH_TRACE_SWAP(r.flags);
+}
+#undef SNITCH_TRACE_SWAP
+#else
+#define SNITCH_TRACE_LITTLE_ENDIAN 1
+
+static inline void snitch_trace_le(snitch_trace_header_t&) {}
+static inline void snitch_trace_le(snitch_trace_record_t&) {}
+#endif
+
+// Streams the records of a binary trace. The file is mapped into memory if
+// possible and read in chunks otherwise, e.g., from a pipe. On big-endian
+// hosts, the records are converted into a copy.
+class snitch_trace_reader_t
+{
+ public:
+  snitch_trace_reader_t();
+  ~snitch_trace_reader_t();
+
+  // Whether the file starts with the magic of a binary trace
+  static bool is_binary(const char* filename);
+
+  bool open(const char* filename);
+  void close();
+
+  // Next record, or NULL at the end of the trace or on an error
+  const snitch_trace_record_t* next();
+
+  const snitch_trace_header_t& header() const { return hdr; }
+  const std::string& error() const { return err; }
+
+ private:
+  snitch_trace_header_t hdr;
+  std::string err;
+  // Memory-mapped file, and the converted record on big-endian hosts
+  const char* map;
+  snitch_trace_record_t swapped;
+  size_t map_size;
+  size_t map_pos;
+  // Chunked fallback
+  FILE* file;
+  std::vector<snitch_trace_record_t> chunk;
+  size_t chunk_pos;
+  size_t chunk_len;
+
+  bool check_header();
+};
+
+#endif
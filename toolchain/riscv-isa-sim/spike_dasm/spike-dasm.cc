@@ -5,27 +5,128 @@
 // in its input, then replaces them with the disassembly
 // enclosed hexadecimal number, interpreted as a RISC-V
 // instruction.
+//
+// Without arguments, it filters stdin to stdout. Given trace files, e.g., the
+// trace_hart_XXXX.dasm of all harts, it processes them in parallel and writes
+// each <name>.dasm to <name>.
 
+#include "dasm_cache.h"
 #include "disasm.h"
 #include "extension.h"
-#include <iostream>
-#include <string>
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
 #include <fesvr/option_parser.h>
 using namespace std;
 
+// Size of the reads and writes
+static const size_t BUFFER_SIZE = 1 << 20;
+
+// Disassembles the lines of in into out. Returns false on an I/O error. The
+// input is read as it becomes available, so with stream set, e.g., when
+// filtering a pipe, each read is written out right away instead of waiting
+// for a full buffer.
+static bool disassemble_file(FILE* in, FILE* out, dasm_cache_t& dasm,
+                             bool stream = false)
+{
+  unique_ptr<char[]> buffer(new char[BUFFER_SIZE]);
+  string line, dis;
+  ssize_t len;
+  while ((len = read(fileno(in), buffer.get(), BUFFER_SIZE)) != 0) {
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    const char* pos = buffer.get();
+    const char* end = pos + len;
+    while (const char* nl = (const char*)memchr(pos, '\n', end - pos)) {
+      // A line that started in the previous read is completed first
+      if (line.empty()) {
+        disassemble_line(pos, nl + 1, dis, dasm);
+      } else {
+        line.append(pos, nl + 1);
+        disassemble_line(line.data(), line.data() + line.size(), dis, dasm);
+        line.clear();
+      }
+      pos = nl + 1;
+    }
+    line.append(pos, end);
+
+    if (dis.size() >= BUFFER_SIZE || (stream && !dis.empty())) {
+      if (fwrite(dis.data(), 1, dis.size(), out) != dis.size())
+        return false;
+      if (stream && fflush(out) != 0)
+        return false;
+      dis.clear();
+    }
+  }
+
+  // Like getline, the last line is terminated even if the input is not
+  if (!line.empty()) {
+    disassemble_line(line.data(), line.data() + line.size(), dis, dasm);
+    dis += '\n';
+  }
+  return fwrite(dis.data(), 1, dis.size(), out) == dis.size();
+}
+
+static string output_name(const string& infile, const string& outdir)
+{
+  size_t slash = infile.rfind('/');
+  string dir = slash == string::npos ? "." : infile.substr(0, slash);
+  string base = slash == string::npos ? infile : infile.substr(slash + 1);
+  return (outdir.empty() ? dir : outdir) + "/" + base.substr(0, base.size() - strlen(".dasm"));
+}
+
+static void help()
+{
+  fprintf(stderr, "usage: spike-dasm [options] [<name>.dasm...]\n");
+  fprintf(stderr, "Replaces DASM(<hex>) by the disassembly of the instruction <hex>, from stdin to\n");
+  fprintf(stderr, "stdout, or from every <name>.dasm to <name>.\n\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  -d, --outdir=<dir>    Write the outputs to <dir> [default: next to the input]\n");
+  fprintf(stderr, "  -j, --jobs=<n>        Process <n> files in parallel [default: all host cores]\n");
+  fprintf(stderr, "      --isa=<name>      RISC-V ISA string [default %s]\n", DEFAULT_ISA);
+#ifdef HAVE_DLOPEN
+  fprintf(stderr, "      --extension=<name> Specify RoCC Extension\n");
+#endif
+  exit(1);
+}
+
 int main(int argc, char** argv)
 {
-  string s;
   const char* isa = DEFAULT_ISA;
+  unsigned jobs = std::thread::hardware_concurrency();
+  string outdir;
 
   std::function<extension_t*()> extension;
   option_parser_t parser;
+  parser.help(&help);
+  parser.option('h', "help", 0, [&](const char* s){help();});
+  parser.option('d', "outdir", 1, [&](const char* s){outdir = s;});
+  parser.option('j', "jobs", 1, [&](const char* s){jobs = atoi(s);});
 #ifdef HAVE_DLOPEN
   parser.option(0, "extension", 1, [&](const char* s){extension = find_extension(s);});
 #endif
   parser.option(0, "isa", 1, [&](const char* s){isa = s;});
-  parser.parse(argv);
+  const char* const* argv1 = parser.parse(argv);
+
+  vector<string> infiles(argv1, (const char* const*)argv + argc);
+  for (auto& infile : infiles) {
+    size_t dot = infile.rfind(".dasm");
+    if (dot == string::npos || dot + strlen(".dasm") != infile.size()) {
+      fprintf(stderr, "%s: not a .dasm file\n", infile.c_str());
+      return 1;
+    }
+  }
 
   std::string lowercase;
   for (const char *p = isa; *p; p++)
@@ -41,6 +142,7 @@ int main(int argc, char** argv)
     return 1;
   }
 
+  // The disassembler is only read from here on and shared by all threads
   disassembler_t* disassembler = new disassembler_t(xlen);
   if (extension) {
     for (auto disasm_insn : extension()->get_disasms()) {
@@ -48,36 +150,46 @@ int main(int argc, char** argv)
     }
   }
 
-  while (getline(cin, s))
-  {
-    for (size_t pos = 0; (pos = s.find("DASM(", pos)) != string::npos; )
-    {
-      size_t start = pos;
-
-      pos += strlen("DASM(");
-
-      if (s[pos] == '0' && (s[pos+1] == 'x' || s[pos+1] == 'X'))
-        pos += 2;
-
-      if (!isxdigit(s[pos]))
-        continue;
-
-      char* endp;
-      int64_t bits = strtoull(&s[pos], &endp, 16);
-      if (*endp != ')')
-        continue;
-
-      size_t nbits = 4 * (endp - &s[pos]);
-      if (nbits < 64)
-        bits = bits << (64 - nbits) >> (64 - nbits);
+  if (infiles.empty()) {
+    dasm_cache_t dasm(*disassembler);
+    return disassemble_file(stdin, stdout, dasm, true) ? 0 : 1;
+  }
 
-      string dis = disassembler->disassemble(bits);
-      s = s.substr(0, start) + dis + s.substr(endp - &s[0] + 1);
-      pos = start + dis.length();
+  vector<string> errors(infiles.size());
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    dasm_cache_t dasm(*disassembler);
+    for (size_t i; (i = next++) < infiles.size(); ) {
+      string outfile = output_name(infiles[i], outdir);
+      FILE* in = fopen(infiles[i].c_str(), "rb");
+      FILE* out = in ? fopen(outfile.c_str(), "wb") : NULL;
+      if (!in)
+        errors[i] = "cannot open " + infiles[i];
+      else if (!out)
+        errors[i] = "cannot open " + outfile;
+      else if (!disassemble_file(in, out, dasm))
+        errors[i] = "cannot write " + outfile;
+      if (out && fclose(out) != 0 && errors[i].empty())
+        errors[i] = "cannot write " + outfile;
+      if (in)
+        fclose(in);
+    }
+  };
+
+  jobs = std::max(1u, std::min<unsigned>(jobs, infiles.size()));
+  vector<std::thread> threads;
+  for (unsigned i = 1; i < jobs; i++)
+    threads.emplace_back(worker);
+  worker();
+  for (auto& thread : threads)
+    thread.join();
+
+  int ret = 0;
+  for (auto& error : errors) {
+    if (!error.empty()) {
+      fprintf(stderr, "%s\n", error.c_str());
+      ret = 1;
     }
-
-    cout << s << '\n';
   }
-
-  return 0;
+  return ret;
 }
@@ -0,0 +1,92 @@
+// See LICENSE for license details.
+
+// This little program prints a binary commit log of spike
+// --log-commits-binary in the text format of --log-commits, i.e.,
+//   core   0: 3 0x80000000 (0x00000297) x 5 0x80000000
+// with one register write and at most one load and store per instruction.
+
+#include "commit_log.h"
+#include "disasm.h"
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <fesvr/option_parser.h>
+
+static void print_value(int width, uint64_t val)
+{
+  switch (width) {
+    case 8:  printf("0x%01" PRIx8, (uint8_t)val); break;
+    case 16: printf("0x%04" PRIx16, (uint16_t)val); break;
+    case 32: printf("0x%08" PRIx32, (uint32_t)val); break;
+    default: printf("0x%016" PRIx64, val); break;
+  }
+}
+
+static void help()
+{
+  fprintf(stderr, "usage: spike-commit-log [options] <file>\n");
+  fprintf(stderr, "Options:\n");
+  fprintf(stderr, "  --hart=<n>    Only print the instructions of hart <n>\n");
+  fprintf(stderr, "  --xlen=<n>    Width of the addresses and x registers [default 32]\n");
+  exit(1);
+}
+
+int main(int argc, char** argv)
+{
+  long only_hart = -1;
+  int xlen = 32;
+
+  option_parser_t parser;
+  parser.help(&help);
+  parser.option('h', "help", 0, [&](const char* s){help();});
+  parser.option(0, "hart", 1, [&](const char* s){only_hart = atol(s);});
+  parser.option(0, "xlen", 1, [&](const char* s){xlen = atoi(s);});
+  const char* const* argv1 = parser.parse(argv);
+  if (!argv1[0] || argv1[1] || (xlen != 32 && xlen != 64))
+    help();
+
+  try {
+    commit_log_reader_t reader(argv1[0]);
+    commit_log_record_t r;
+    uint32_t hart;
+    while (reader.next(r, hart)) {
+      if (only_hart >= 0 && hart != (uint32_t)only_hart)
+        continue;
+
+      printf("core%4" PRIu32 ": %1d ", hart, r.priv);
+      print_value(xlen, r.pc);
+      printf(" (");
+      print_value(insn_length(r.insn) * 8, r.insn);
+      printf(")");
+
+      if (r.flags & commit_log_record_t::REG_WRITE) {
+        int reg = r.reg >> 4;
+        switch (r.reg & 0xf) {
+          case 0: printf(" x%2d ", reg); print_value(xlen, r.reg_value); break;
+          case 1: printf(" f%2d ", reg); print_value(64, r.reg_value); break;
+          default:
+            printf(" c%d_%s ", reg, csr_name(reg));
+            print_value(xlen, r.reg_value);
+            break;
+        }
+      }
+      if (r.flags & commit_log_record_t::LOAD) {
+        printf(" mem ");
+        print_value(xlen, r.load_addr);
+      }
+      if (r.flags & commit_log_record_t::STORE) {
+        printf(" mem ");
+        print_value(xlen, r.store_addr);
+        printf(" ");
+        print_value(r.store_size * 8, r.store_value);
+      }
+      printf("\n");
+    }
+  } catch (std::runtime_error& e) {
+    fflush(stdout);
+    fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+  return 0;
+}
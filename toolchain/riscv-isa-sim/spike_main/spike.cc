@@ -5,6 +5,10 @@
 #include "remote_bitbang.h"
 #include "cachesim.h"
 #include "extension.h"
+#include "mempool.h"
+#include "mempool_timing.h"
+#include <chrono>
+#include <cinttypes>
 #include <dlfcn.h>
 #include <fesvr/option_parser.h>
 #include <stdio.h>
@@ -20,16 +24,18 @@ static void help(int exit_code = 1)
   fprintf(stderr, "Spike RISC-V ISA Simulator " SPIKE_VERSION "\n\n");
   fprintf(stderr, "usage: spike [host options] <target program> [target options]\n");
   fprintf(stderr, "Host Options:\n");
-  fprintf(stderr, "  -p<n>                 Simulate <n> processors [default 1]\n");
+  fprintf(stderr, "  -p<n>                 Simulate <n> processors [default 1, or %d with --mempool]\n", MEMPOOL_NUM_CORES);
   fprintf(stderr, "  -m<n>                 Provide <n> MiB of target memory [default 2048]\n");
   fprintf(stderr, "  -m<a:m,b:n,...>       Provide memory regions of size m and n bytes\n");
   fprintf(stderr, "                          at base addresses a and b (with 4 KiB alignment)\n");
   fprintf(stderr, "  -d                    Interactive debug mode\n");
-  fprintf(stderr, "  -g                    Track histogram of PCs\n");
+  fprintf(stderr, "  -t<n>                 Run the processors on <n> host threads [default 1]\n");
+  fprintf(stderr, "  -g                    Track histogram of PCs and print the instructions\n");
+  fprintf(stderr, "                          per function\n");
   fprintf(stderr, "  -l                    Generate a log of execution\n");
   fprintf(stderr, "  -h, --help            Print this help message\n");
   fprintf(stderr, "  -H                    Start halted, allowing a debugger to connect\n");
-  fprintf(stderr, "  --isa=<name>          RISC-V ISA string [default %s]\n", DEFAULT_ISA);
+  fprintf(stderr, "  --isa=<name>          RISC-V ISA string [default %s, or rv32ima with --mempool]\n", DEFAULT_ISA);
   fprintf(stderr, "  --priv=<m|mu|msu>     RISC-V privilege modes supported [default %s]\n", DEFAULT_PRIV);
   fprintf(stderr, "  --varch=<name>        RISC-V Vector uArch string [default %s]\n", DEFAULT_VARCH);
   fprintf(stderr, "  --pc=<address>        Override ELF entry point\n");
@@ -43,7 +49,23 @@ static void help(int exit_code = 1)
   fprintf(stderr, "                          A -- String arguments to pass to the plugin\n");
   fprintf(stderr, "                          This flag can be used multiple times.\n");
   fprintf(stderr, "                          The extlib flag for the library must come first.\n");
+  fprintf(stderr, "  --mempool             Simulate a MemPool cluster with its L1 at 0x%x, its\n", MEMPOOL_L1_BASE);
+  fprintf(stderr, "                          L2 at 0x%x, control registers and UART.\n", MEMPOOL_L2_BASE);
+  fprintf(stderr, "                          -m<a:m> overrides the L2 [default 0x%x:0x%x]\n", MEMPOOL_L2_BASE, MEMPOOL_L2_SIZE);
+  fprintf(stderr, "  --mempool-groups=<n>  Split the cores of the MemPool cluster into <n> groups\n");
+  fprintf(stderr, "                          [default %d, or 1 if it does not divide -p]\n", MEMPOOL_NUM_GROUPS);
+  fprintf(stderr, "  --mempool-timing      Estimate the cycles of MemPool per trace region, with\n");
+  fprintf(stderr, "                          the stalls of the L1 and instruction caches\n");
+  fprintf(stderr, "  --mempool-stats=<file> Write the timing statistics of every hart and tile to <file>\n");
+  fprintf(stderr, "  --profile=<file>      Like -g, and write the instructions per hart, function,\n");
+  fprintf(stderr, "                          and basic block to <file> as folded stacks\n");
+  fprintf(stderr, "  --block-cache         Dispatch the instructions from decoded basic blocks\n");
+  fprintf(stderr, "                          instead of one by one\n");
+  fprintf(stderr, "  --mips                Print the simulated instructions per second at exit\n");
   fprintf(stderr, "  --log-cache-miss      Generate a log of cache miss\n");
+  fprintf(stderr, "  --log-commits         Generate a log of commits info\n");
+  fprintf(stderr, "  --log-commits-binary=<file> Write the commits in the binary format of\n");
+  fprintf(stderr, "                          riscv/commit_log.h to <file>, see spike-commit-log\n");
   fprintf(stderr, "  --extension=<name>    Specify RoCC Extension\n");
   fprintf(stderr, "  --extlib=<name>       Shared library to load\n");
   fprintf(stderr, "                        This flag can be used multiple times.\n");
@@ -187,11 +209,19 @@ int main(int argc, char** argv)
   bool debug = false;
   bool halted = false;
   bool histogram = false;
+  const char* profile = NULL;
+  bool block_cache = false;
+  bool mips = false;
   bool log = false;
   bool dump_dts = false;
   bool dtb_enabled = true;
   bool real_time_clint = false;
-  size_t nprocs = 1;
+  bool mempool = false;
+  bool mempool_timing = false;
+  const char* mempool_stats = NULL;
+  size_t mempool_groups = 0;
+  size_t nprocs = 0;
+  size_t nthreads = 1;
   const char* kernel = NULL;
   reg_t kernel_offset, kernel_size;
   size_t initrd_size;
@@ -206,9 +236,10 @@ int main(int argc, char** argv)
   bool log_cache = false;
   bool log_commits = false;
   const char *log_path = nullptr;
+  const char *commit_log_path = nullptr;
   std::function<extension_t*()> extension;
   const char* initrd = NULL;
-  const char* isa = DEFAULT_ISA;
+  const char* isa = NULL;
   const char* priv = DEFAULT_PRIV;
   const char* varch = DEFAULT_VARCH;
   const char* dtb_file = NULL;
@@ -289,6 +320,7 @@ int main(int argc, char** argv)
   parser.option('g', 0, 0, [&](const char* s){histogram = true;});
   parser.option('l', 0, 0, [&](const char* s){log = true;});
   parser.option('p', 0, 1, [&](const char* s){nprocs = atoi(s);});
+  parser.option('t', 0, 1, [&](const char* s){nthreads = atoi(s);});
   parser.option('m', 0, 1, [&](const char* s){mems = make_mems(s);});
   // I wanted to use --halted, but for some reason that doesn't work.
   parser.option('H', 0, 0, [&](const char* s){halted = true;});
@@ -298,6 +330,13 @@ int main(int argc, char** argv)
   parser.option(0, "ic", 1, [&](const char* s){ic.reset(new icache_sim_t(s));});
   parser.option(0, "dc", 1, [&](const char* s){dc.reset(new dcache_sim_t(s));});
   parser.option(0, "l2", 1, [&](const char* s){l2.reset(cache_sim_t::construct(s, "L2$"));});
+  parser.option(0, "mempool", 0, [&](const char* s){mempool = true;});
+  parser.option(0, "mempool-groups", 1, [&](const char* s){mempool_groups = atoi(s);});
+  parser.option(0, "mempool-timing", 0, [&](const char* s){mempool_timing = true;});
+  parser.option(0, "mempool-stats", 1, [&](const char* s){mempool_timing = true; mempool_stats = s;});
+  parser.option(0, "profile", 1, [&](const char* s){histogram = true; profile = s;});
+  parser.option(0, "block-cache", 0, [&](const char* s){block_cache = true;});
+  parser.option(0, "mips", 0, [&](const char* s){mips = true;});
   parser.option(0, "log-cache-miss", 0, [&](const char* s){log_cache = true;});
   parser.option(0, "isa", 1, [&](const char* s){isa = s;});
   parser.option(0, "priv", 1, [&](const char* s){priv = s;});
@@ -338,14 +377,50 @@ int main(int argc, char** argv)
       [&](const char* s){dm_config.support_haltgroups = false;});
   parser.option(0, "log-commits", 0,
                 [&](const char* s){log_commits = true;});
+  parser.option(0, "log-commits-binary", 1,
+                [&](const char* s){log_commits = true; commit_log_path = s;});
   parser.option(0, "log", 1,
                 [&](const char* s){log_path = s;});
 
   auto argv1 = parser.parse(argv);
   std::vector<std::string> htif_args(argv1, (const char*const*)argv + argc);
+  if (!nprocs)
+    nprocs = mempool ? MEMPOOL_NUM_CORES : 1;
+  if (!isa)
+    isa = mempool ? "rv32ima" : DEFAULT_ISA;
+  reg_t l2_base = MEMPOOL_L2_BASE;
+  mem_t* l1 = NULL;
+  if (mempool) {
+    if (mems.empty())
+      mems.push_back(std::make_pair(l2_base, new mem_t(MEMPOOL_L2_SIZE)));
+    l2_base = mems.front().first;
+    l1 = new mem_t(nprocs * MEMPOOL_L1_SIZE_PER_CORE);
+    mems.push_back(std::make_pair(reg_t(MEMPOOL_L1_BASE), l1));
+    // The boot ROM would overlap with the L1
+    dtb_enabled = false;
+  }
   if (mems.empty())
     mems = make_mems("2048");
 
+  if (!mempool_groups)
+    mempool_groups = nprocs % MEMPOOL_NUM_GROUPS == 0 ? MEMPOOL_NUM_GROUPS : 1;
+  if (mempool && nprocs % mempool_groups != 0) {
+    fprintf(stderr, "--mempool-groups must divide the number of processors\n");
+    exit(1);
+  }
+
+  if (mempool_timing && !mempool) {
+    fprintf(stderr, "--mempool-timing requires --mempool\n");
+    exit(1);
+  }
+
+  if (nthreads > 1 && (debug || log || (log_commits && !commit_log_path) ||
+                       ic || dc || l2 || mempool_timing)) {
+    fprintf(stderr, "-t<n> cannot be combined with -d, -l, --log-commits, "
+                    "or the cache and timing models\n");
+    exit(1);
+  }
+
   if (!*argv1)
     help();
 
@@ -378,6 +453,13 @@ int main(int argc, char** argv)
   sim_t s(isa, priv, varch, nprocs, halted, real_time_clint,
       initrd_start, initrd_end, bootargs, start_pc, mems, plugin_devices, htif_args,
       std::move(hartids), dm_config, log_path, dtb_enabled, dtb_file);
+  std::unique_ptr<mempool_t> mempool_model;
+  if (mempool)
+    mempool_model.reset(new mempool_t(&s, l1, l2_base, mempool_groups));
+  std::unique_ptr<mempool_timing_t> timing_model;
+  if (mempool_timing)
+    timing_model.reset(new mempool_timing_t(&s, mempool_model.get(), l1->size(),
+                                            mempool_stats));
   std::unique_ptr<remote_bitbang_t> remote_bitbang((remote_bitbang_t *) NULL);
   std::unique_ptr<jtag_dtm_t> jtag_dtm(
       new jtag_dtm_t(&s.debug_module, dmi_rti));
@@ -400,13 +482,25 @@ int main(int argc, char** argv)
     if (ic) s.get_core(i)->get_mmu()->register_memtracer(&*ic);
     if (dc) s.get_core(i)->get_mmu()->register_memtracer(&*dc);
     if (extension) s.get_core(i)->register_extension(extension());
+    s.get_core(i)->get_mmu()->set_block_cache(block_cache);
   }
 
   s.set_debug(debug);
-  s.configure_log(log, log_commits);
+  s.configure_log(log, log_commits, commit_log_path);
   s.set_histogram(histogram);
+  s.set_profile(profile);
+  s.set_threads(nthreads);
 
+  auto start = std::chrono::steady_clock::now();
   auto return_code = s.run();
+  if (mips) {
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    uint64_t instret = 0;
+    for (size_t i = 0; i < nprocs; i++)
+      instret += s.get_core(i)->get_instret();
+    fprintf(stderr, "Simulated %" PRIu64 " instructions in %.3f s: %.2f MIPS\n",
+            instret, seconds.count(), instret / seconds.count() / 1e6);
+  }
 
   for (auto& mem : mems)
     delete mem.second;